@@ -0,0 +1,250 @@
+#include "engine.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// brute force check for the auction uncross, so the price rules in
+// MatchingEngine::indicative() stay covered by something you can run
+//
+//   auction_check [--books N] [--seed S] [--bench ORDERS]
+//       --books   random call books to check (default 2000)
+//       --bench   after the check, time indicative() + uncross() on one big book
+//
+// every book gets priced twice: by the engine, and here by trying every limit
+// price against the raw order list with the rules spelled out one by one
+// (max volume, min |imbalance|, market pressure, closest to the reference,
+// else the middle of the tie). then the real uncross runs and the fills and
+// the book left behind get checked. a book with only market orders and no
+// reference price is supposed to stay unpriced, that's checked too.
+// exit 1 on the first mismatch with the seed + book number to reproduce it.
+namespace {
+
+    using namespace trading;
+
+    struct Fills : EventListener {
+        Quantity volume = 0;
+        std::vector<Price> prices;
+        void on_event(const EngineEvent& ev) override {
+            if (ev.type != EventType::Fill) return;
+            volume += ev.qty;
+            prices.push_back(ev.price);
+        }
+    };
+
+    struct Eligible { Quantity demand = 0, supply = 0; };
+
+    Eligible eligible_at(const std::vector<std::shared_ptr<Order>>& orders, Price p) {
+        Eligible e;
+        for (auto& o : orders) {
+            bool market = o->type == OrderType::Market;
+            if (o->side == Side::Buy && (market || o->price >= p)) e.demand += o->remaining();
+            if (o->side == Side::Sell && (market || o->price <= p)) e.supply += o->remaining();
+        }
+        return e;
+    }
+
+    AuctionResult brute_force(const std::vector<std::shared_ptr<Order>>& orders, Price reference) {
+        std::vector<Price> candidates;
+        for (auto& o : orders)
+            if (o->type == OrderType::Limit) candidates.push_back(o->price);
+        if (candidates.empty() && reference > 0) candidates.push_back(reference);
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        std::vector<AuctionResult> all;
+        for (auto p : candidates) {
+            auto e = eligible_at(orders, p);
+            AuctionResult r{ true, p, std::min(e.demand, e.supply), e.demand - e.supply };
+            if (r.volume > 0) all.push_back(r);
+        }
+        if (all.empty()) return {};
+
+        auto abs = [](Quantity q) { return q < 0 ? -q : q; };
+        Quantity max_vol = 0;
+        for (auto& r : all) max_vol = std::max(max_vol, r.volume);
+        std::vector<AuctionResult> ties;
+        for (auto& r : all) if (r.volume == max_vol) ties.push_back(r);
+
+        Quantity min_imb = abs(ties.front().imbalance);
+        for (auto& r : ties) min_imb = std::min(min_imb, abs(r.imbalance));
+        std::vector<AuctionResult> left;
+        for (auto& r : ties) if (abs(r.imbalance) == min_imb) left.push_back(r);
+        if (left.size() == 1) return left.front();
+
+        bool all_buy = true, all_sell = true;
+        for (auto& r : left) {
+            all_buy = all_buy && r.imbalance > 0;
+            all_sell = all_sell && r.imbalance < 0;
+        }
+        if (all_buy) return left.back();
+        if (all_sell) return left.front();
+        if (reference <= 0) return left[(left.size() - 1) / 2];
+
+        auto best = left.front();
+        for (auto& r : left)
+            if (abs(r.price - reference) < abs(best.price - reference)) best = r;
+        return best;
+    }
+
+    std::string describe(const AuctionResult& r) {
+        if (!r.crossed) return "no cross";
+        return std::to_string(r.volume) + " @ " + std::to_string(r.price) +
+            " imbalance " + std::to_string(r.imbalance);
+    }
+
+    bool same(const AuctionResult& a, const AuctionResult& b) {
+        if (a.crossed != b.crossed) return false;
+        return !a.crossed || (a.price == b.price && a.volume == b.volume && a.imbalance == b.imbalance);
+    }
+
+    std::shared_ptr<Order> random_order(std::mt19937_64& rng, uint64_t id, bool markets) {
+        auto o = std::make_shared<Order>();
+        o->id = "o" + std::to_string(id);
+        o->symbol = "CHK";
+        o->side = (rng() & 1) ? Side::Buy : Side::Sell;
+        o->type = markets && rng() % 8 == 0 ? OrderType::Market : OrderType::Limit;
+        o->price = o->type == OrderType::Limit ? static_cast<Price>(95 + rng() % 11) * 10000 : 0;
+        o->qty = static_cast<Quantity>(1 + rng() % 20);
+        o->timestamp = CoarseClock::now();
+        return o;
+    }
+
+    // one random call book through the engine and the brute force. returns
+    // an error message, empty if everything lined up
+    std::string check_book(std::mt19937_64& rng) {
+        MatchingEngine me("CHK");
+        Fills fills;
+        me.set_listener(&fills);
+        me.start_auction();
+
+        // every so often: markets only, to hit the reference price path. round
+        // lots on half the books so equal volume / imbalance ties are common
+        bool markets_only = rng() % 20 == 0;
+        bool round_lots = rng() & 1;
+        std::vector<std::shared_ptr<Order>> orders;
+        int n = 1 + static_cast<int>(rng() % 40);
+        for (int i = 0; i < n; ++i) {
+            auto o = random_order(rng, static_cast<uint64_t>(i), true);
+            if (round_lots) o->qty = 10 * (1 + o->qty % 4);
+            if (markets_only) {
+                o->type = OrderType::Market;
+                o->price = 0;
+            }
+            me.handle(o);
+            orders.push_back(o);
+        }
+        // pull a few back out so the level totals see removes too
+        for (int i = 0, k = static_cast<int>(rng() % 4); i < k && !orders.empty(); ++i) {
+            auto at = orders.begin() + static_cast<long>(rng() % orders.size());
+            me.cancel(*at);
+            orders.erase(at);
+        }
+
+        Price reference = rng() % 3 == 0 ? 0 : static_cast<Price>(95 + rng() % 11) * 10000;
+        auto want = brute_force(orders, reference);
+        auto got = me.indicative(reference);
+        if (!same(got, want))
+            return "indicative " + describe(got) + ", brute force " + describe(want) +
+                " (reference " + std::to_string(reference) + ")";
+        if (markets_only && reference <= 0 && got.crossed)
+            return "markets only, no reference, but priced at " + std::to_string(got.price);
+
+        auto done = me.uncross(reference);
+        if (!same(done, want)) return "uncross " + describe(done) + ", indicative said " + describe(want);
+        if (me.get_mode() != TradingMode::Continuous) return "still in auction after uncross";
+        if (fills.volume != want.volume)
+            return "filled " + std::to_string(fills.volume) + ", expected " + std::to_string(want.volume);
+        for (auto p : fills.prices)
+            if (p != want.price) return "fill at " + std::to_string(p) + ", auction price " + std::to_string(want.price);
+
+        Price best_bid = 0, best_ask = 0;
+        for (auto& o : orders) {
+            if (o->type != OrderType::Limit || o->is_filled()) continue;
+            if (o->side == Side::Buy) best_bid = std::max(best_bid, o->price);
+            else if (!best_ask || o->price < best_ask) best_ask = o->price;
+        }
+        if (best_bid && best_ask && best_bid >= best_ask)
+            return "book still crossed: " + std::to_string(best_bid) + " / " + std::to_string(best_ask);
+        return {};
+    }
+
+    // when the last fill left the engine, which is what the market sees. the
+    // rest of uncross() is cleanup after it
+    struct LastFill : EventListener {
+        uint64_t fills = 0;
+        std::chrono::steady_clock::time_point at;
+        void on_event(const EngineEvent& ev) override {
+            if (ev.type != EventType::Fill) return;
+            ++fills;
+            at = std::chrono::steady_clock::now();
+        }
+    };
+
+    void bench(std::mt19937_64& rng, uint64_t n) {
+        MatchingEngine me("CHK");
+        LastFill last;
+        me.start_auction();
+        for (uint64_t i = 0; i < n; ++i) {
+            auto o = random_order(rng, i, false);
+            // wide book that overlaps by a third, so the uncross has real work
+            o->price = static_cast<Price>(9000 + rng() % 2000) * 100 + (o->side == Side::Buy ? 0 : 3000);
+            o->qty = 100;
+            me.handle(o);
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        auto ind = me.indicative();
+        auto t1 = std::chrono::steady_clock::now();
+        me.set_listener(&last);
+        auto done = me.uncross();
+        auto t2 = std::chrono::steady_clock::now();
+        auto ms = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+        std::printf("%llu orders: indicative %.3f ms, uncross %.3f ms (%llu fills, last one out at %.3f ms), %s\n",
+            static_cast<unsigned long long>(n), ms(t1 - t0), ms(t2 - t1),
+            static_cast<unsigned long long>(last.fills), ms(last.at - t1), describe(done).c_str());
+        if (!same(ind, done)) throw std::runtime_error("bench: uncross disagrees with indicative");
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    uint64_t books = 2000, seed = 42, bench_orders = 0;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) throw std::runtime_error("missing value for " + arg);
+            uint64_t v = std::stoull(argv[++i]);
+            if (arg == "--books") books = v;
+            else if (arg == "--seed") seed = v;
+            else if (arg == "--bench") bench_orders = v;
+            else throw std::runtime_error("unknown arg " + arg);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n"
+            << "usage: " << argv[0] << " [--books N] [--seed S] [--bench ORDERS]\n";
+        return 1;
+    }
+
+    try {
+        Logger::enabled = false;
+        CoarseClock::Session clock;
+        std::mt19937_64 rng(seed);
+        for (uint64_t i = 0; i < books; ++i) {
+            auto err = check_book(rng);
+            if (!err.empty()) {
+                std::cerr << "book " << i << " (seed " << seed << "): " << err << "\n";
+                return 1;
+            }
+        }
+        std::cout << books << " books ok\n";
+        if (bench_orders) bench(rng, bench_orders);
+    } catch (const std::exception& e) {
+        std::cerr << "bruh: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include "fix.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// raw inbound order flow capture. one record per FIX message exactly as the
+// gateway framed it off the wire (SOH delimited, BeginString through
+// CheckSum) plus when it was received, so a day can be pushed back through
+// the engine later. see replay.cpp.
+//
+// layout (little endian, host order):
+//   "MNCP" u32 version u64 reserved
+//   record*: i64 ts_ns (wall clock, since epoch) u32 len, len bytes
+//
+// a writer that died mid record leaves a torn tail, readers stop at the last
+// complete record
+namespace trading::capture {
+
+    constexpr uint32_t MAGIC = 0x50434e4d;  // "MNCP"
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t HEADER_BYTES = 16;
+    constexpr size_t RECORD_HEADER_BYTES = 12;
+
+    struct Record {
+        int64_t ts_ns;
+        std::string_view data;
+    };
+
+    class CaptureWriter {
+        std::FILE* file = nullptr;
+        uint64_t count = 0;
+
+        template<typename T>
+        void put(const T& v) {
+            if (std::fwrite(&v, sizeof(T), 1, file) != 1) throw std::runtime_error("capture: write failed");
+        }
+
+    public:
+        explicit CaptureWriter(const std::string& path) {
+            file = std::fopen(path.c_str(), "wb");
+            if (!file) throw std::runtime_error("capture: can't open " + path);
+            std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+            put(MAGIC);
+            put(VERSION);
+            put(uint64_t(0));
+        }
+
+        ~CaptureWriter() { close(); }
+
+        CaptureWriter(const CaptureWriter&) = delete;
+        CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+        // data has to be one whole framed message, replay hands each record
+        // straight to the decoder
+        void write(int64_t ts_ns, std::string_view data) {
+            if (fix::frame_length(data) != data.size())
+                throw std::runtime_error("capture: record isn't exactly one FIX message");
+            put(ts_ns);
+            put(static_cast<uint32_t>(data.size()));
+            if (std::fwrite(data.data(), 1, data.size(), file) != data.size())
+                throw std::runtime_error("capture: write failed");
+            ++count;
+        }
+
+        uint64_t records() const { return count; }
+
+        void close() {
+            if (file) std::fclose(file);
+            file = nullptr;
+        }
+    };
+
+    // the whole file gets mmap'd read only and walked front to back, so a
+    // multi GB day just streams through the page cache instead of sitting in
+    // our heap. records hand out views straight into the mapping
+    class CaptureReader {
+        const uint8_t* base = nullptr;
+        size_t size = 0;
+
+    public:
+        class Iterator {
+            const uint8_t* p;
+            const uint8_t* end;
+            Record rec{};
+
+            // a torn record at the tail ends iteration there
+            void load() {
+                if (p == end) return;
+                size_t left = size_t(end - p);
+                uint32_t len = 0;
+                if (left >= RECORD_HEADER_BYTES) std::memcpy(&len, p + 8, 4);
+                if (left < RECORD_HEADER_BYTES || left - RECORD_HEADER_BYTES < len) {
+                    p = end;
+                    return;
+                }
+                std::memcpy(&rec.ts_ns, p, 8);
+                rec.data = std::string_view(reinterpret_cast<const char*>(p + RECORD_HEADER_BYTES), len);
+            }
+
+        public:
+            Iterator(const uint8_t* pos, const uint8_t* e) : p(pos), end(e) { load(); }
+
+            const Record& operator*() const { return rec; }
+            const Record* operator->() const { return &rec; }
+            Iterator& operator++() {
+                p += RECORD_HEADER_BYTES + rec.data.size();
+                load();
+                return *this;
+            }
+            bool operator!=(const Iterator& o) const { return p != o.p; }
+        };
+
+        explicit CaptureReader(const std::string& path) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) throw std::runtime_error("capture: can't open " + path);
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(HEADER_BYTES)) {
+                ::close(fd);
+                throw std::runtime_error("capture: not a capture file: " + path);
+            }
+            size = static_cast<size_t>(st.st_size);
+            void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) throw std::runtime_error("capture: mmap failed");
+            base = static_cast<const uint8_t*>(p);
+            madvise(p, size, MADV_SEQUENTIAL);
+
+            uint32_t magic, version;
+            std::memcpy(&magic, base, 4);
+            std::memcpy(&version, base + 4, 4);
+            if (magic != MAGIC || version != VERSION) {
+                munmap(p, size);
+                throw std::runtime_error("capture: not a capture file: " + path);
+            }
+        }
+
+        ~CaptureReader() { if (base) munmap(const_cast<uint8_t*>(base), size); }
+
+        CaptureReader(const CaptureReader&) = delete;
+        CaptureReader& operator=(const CaptureReader&) = delete;
+
+        Iterator begin() const { return Iterator(base + HEADER_BYTES, base + size); }
+        Iterator end() const { return Iterator(base + size, base + size); }
+
+        size_t bytes() const { return size; }
+    };
+
+}  // namespace trading::capture
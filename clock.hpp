@@ -0,0 +1,204 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+
+namespace trading {
+
+    namespace detail {
+        // 24 chars packed into 3 words so the seqlock copy is race free
+        constexpr size_t CLOCK_WORDS = 3;
+
+        struct alignas(64) ClockState {
+            std::atomic<uint64_t> seq{0};
+            std::atomic<int64_t> now_us{0};
+            std::array<std::atomic<uint64_t>, CLOCK_WORDS> text{};
+        };
+
+        // owns the ticker thread. a program that exits (or unwinds out of
+        // main) without calling stop() would otherwise die in ~thread with
+        // std::terminate, so the static destructor joins it for us
+        struct ClockTicker {
+            std::atomic<bool> running{false};
+            std::thread thread;
+
+            void stop() {
+                if (!running.exchange(false)) return;
+                if (thread.joinable()) thread.join();
+            }
+
+            ~ClockTicker() { stop(); }
+        };
+    }
+
+    // coarse cached wall clock. a ticker thread keeps "now" plus a pre-formatted
+    // UTC timestamp ("YYYYMMDD-HH:MM:SS.uuuuuu") so the hot path never touches
+    // gmtime / put_time / stringstream. readers are lock-free (seqlock).
+    //
+    // if nobody called start() we just format on the spot, so single threaded
+    // stuff like the test harness in orderbook.cpp still gets a real time.
+    class CoarseClock {
+    public:
+        using TimePoint = std::chrono::system_clock::time_point;
+
+        static constexpr size_t MICROS_LEN = 24;  // YYYYMMDD-HH:MM:SS.uuuuuu
+        static constexpr size_t MILLIS_LEN = 21;  // YYYYMMDD-HH:MM:SS.mmm (what FIX 4.2 allows)
+        static constexpr size_t DATE_LEN = 9;     // YYYYMMDD-
+
+        using Buffer = std::array<char, MICROS_LEN>;
+        static_assert(MICROS_LEN == detail::CLOCK_WORDS * sizeof(uint64_t));
+
+    private:
+        static constexpr size_t WORDS = detail::CLOCK_WORDS;
+
+        static inline detail::ClockState state;
+        static inline detail::ClockTicker ticker;
+
+        // writer side only, touched by the ticker thread
+        static inline Buffer scratch{};
+        static inline int64_t scratch_second = -1;
+
+        static int64_t wall_us() {
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        static void put_digits(char* out, uint32_t value, int width) {
+            for (int i = width - 1; i >= 0; --i) {
+                out[i] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            }
+        }
+
+        // only redo the expensive calendar bit when the second rolls over,
+        // otherwise just poke the 6 fractional digits
+        static void format_into(Buffer& buf, int64_t& cached_second, int64_t us) {
+            int64_t sec = us / 1000000;
+            if (sec != cached_second) {
+                std::time_t tt = static_cast<std::time_t>(sec);
+                std::tm tm{};
+                gmtime_r(&tt, &tm);
+                put_digits(&buf[0], tm.tm_year + 1900, 4);
+                put_digits(&buf[4], tm.tm_mon + 1, 2);
+                put_digits(&buf[6], tm.tm_mday, 2);
+                buf[8] = '-';
+                put_digits(&buf[9], tm.tm_hour, 2);
+                buf[11] = ':';
+                put_digits(&buf[12], tm.tm_min, 2);
+                buf[14] = ':';
+                put_digits(&buf[15], tm.tm_sec, 2);
+                buf[17] = '.';
+                cached_second = sec;
+            }
+            put_digits(&buf[18], static_cast<uint32_t>(us % 1000000), 6);
+        }
+
+        static void publish(int64_t us) {
+            format_into(scratch, scratch_second, us);
+            uint64_t words[WORDS];
+            std::memcpy(words, scratch.data(), MICROS_LEN);
+
+            auto s = state.seq.load(std::memory_order_relaxed);
+            state.seq.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            state.now_us.store(us, std::memory_order_relaxed);
+            for (size_t i = 0; i < WORDS; ++i)
+                state.text[i].store(words[i], std::memory_order_relaxed);
+            state.seq.store(s + 2, std::memory_order_release);
+        }
+
+        static Buffer read_buffer() {
+            Buffer buf;
+            if (!ticker.running.load(std::memory_order_acquire)) {
+                int64_t no_cache = -1;
+                format_into(buf, no_cache, wall_us());
+                return buf;
+            }
+
+            uint64_t words[WORDS];
+            uint64_t before, after;
+            do {
+                before = state.seq.load(std::memory_order_acquire);
+                for (size_t i = 0; i < WORDS; ++i)
+                    words[i] = state.text[i].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = state.seq.load(std::memory_order_relaxed);
+            } while (before != after || (before & 1));
+
+            std::memcpy(buf.data(), words, MICROS_LEN);
+            return buf;
+        }
+
+    public:
+        // spin up the ticker. resolution is how stale a reader is allowed to be
+        static void start(std::chrono::microseconds resolution = std::chrono::microseconds(100)) {
+            if (ticker.running.load()) return;
+            publish(wall_us());
+            ticker.running.store(true, std::memory_order_release);
+            ticker.thread = std::thread([resolution] {
+                while (ticker.running.load(std::memory_order_relaxed)) {
+                    publish(wall_us());
+                    std::this_thread::sleep_for(resolution);
+                }
+            });
+        }
+
+        static void stop() { ticker.stop(); }
+
+        static bool is_running() { return ticker.running.load(std::memory_order_relaxed); }
+
+        static int64_t now_us() {
+            if (!ticker.running.load(std::memory_order_acquire)) return wall_us();
+            return state.now_us.load(std::memory_order_relaxed);
+        }
+
+        static TimePoint now() {
+            return TimePoint(std::chrono::duration_cast<TimePoint::duration>(
+                std::chrono::microseconds(now_us())));
+        }
+
+        // FIX UTCTimestamp, millis
+        static std::string fix_timestamp() {
+            auto buf = read_buffer();
+            return std::string(buf.data(), MILLIS_LEN);
+        }
+
+        static std::string fix_timestamp_us() {
+            auto buf = read_buffer();
+            return std::string(buf.data(), MICROS_LEN);
+        }
+
+        // HH:MM:SS.mmm for log lines
+        static std::string time_of_day() {
+            auto buf = read_buffer();
+            return std::string(buf.data() + DATE_LEN, MILLIS_LEN - DATE_LEN);
+        }
+
+        // same formatting for an arbitrary time point (no caching)
+        static std::string format(TimePoint tp) {
+            Buffer buf;
+            int64_t no_cache = -1;
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+            format_into(buf, no_cache, us);
+            return std::string(buf.data(), MILLIS_LEN);
+        }
+
+        // start() / stop() tied to a scope, for code with early returns or throws
+        class Session {
+        public:
+            explicit Session(std::chrono::microseconds resolution = std::chrono::microseconds(100)) {
+                start(resolution);
+            }
+            ~Session() { stop(); }
+
+            Session(const Session&) = delete;
+            Session& operator=(const Session&) = delete;
+        };
+    };
+
+}  // namespace trading
@@ -0,0 +1,695 @@
+#pragma once
+#include "events.hpp"
+#include "runtime.hpp"
+#include "spsc_queue.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// drop copy / audit trail. every NEW, FILL and CANCEL the engine emits goes
+// through an spsc ring to a consumer thread that packs them into a columnar
+// block file. the match thread never waits on it.
+//
+// file layout (little endian, host order):
+//   "MNDC" u32 version
+//   block*:
+//     u32 'BLK1'  u32 rows  i64 ts_min  i64 ts_max  u32 raw_bytes  u32 payload_bytes
+//     u64 bloom[BLOOM_WORDS]             order_id + contra_id of every row
+//     u8 n_syms, (u8 len, chars)*        symbols present in the block
+//     payload: lz(columns)               only read if the header says it might match
+//   index (written on close, a crashed file is still readable by scanning):
+//     (u64 offset, i64 ts_min, i64 ts_max, u32 rows)*  u64 index_offset  u32 n_blocks  u32 'MNDX'
+//
+// columns inside a block, each one contiguous:
+//   string table (varint n, (varint len, chars)*), then per row:
+//   symbol idx, flags byte (type | side | ord type | id / symbol truncated), ts - ts_min, zigzag price delta,
+//   qty, leaves, order_id idx, contra_id idx + 1 (0 = none)
+namespace trading::dropcopy {
+
+    constexpr uint32_t FILE_MAGIC = 0x43444e4d;   // "MNDC"
+    constexpr uint32_t BLOCK_MAGIC = 0x314b4c42;  // "BLK1"
+    constexpr uint32_t INDEX_MAGIC = 0x58444e4d;  // "MNDX"
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t BLOOM_WORDS = 512;           // 32k bits, ~2% fp for a full 8k row block
+
+    using Bytes = std::vector<uint8_t>;
+
+    // --- varints -----------------------------------------------------------
+
+    inline void put_varint(Bytes& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    inline uint64_t get_varint(const uint8_t*& p, const uint8_t* end) {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p == end) throw std::runtime_error("dropcopy: truncated varint");
+            uint8_t b = *p++;
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        throw std::runtime_error("dropcopy: bad varint");
+    }
+
+    inline uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+    inline int64_t unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+    inline uint64_t hash_id(std::string_view s) {
+        uint64_t h = 1469598103934665603ull;  // fnv-1a
+        for (char c : s) {
+            h ^= static_cast<uint8_t>(c);
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    // --- block compression ----------------------------------------------------
+    // tiny lz77: (varint literal_len, literals, varint match_len - 4, varint offset)*
+    // with a final literal run. the columns are already varint packed, this
+    // mostly eats the repeated ids / symbols / flag runs
+
+    namespace lz {
+        constexpr int HASH_BITS = 14;
+        constexpr size_t MIN_MATCH = 4;
+        constexpr size_t MAX_OFFSET = 1 << 16;
+
+        inline uint32_t read32(const uint8_t* p) {
+            uint32_t v;
+            std::memcpy(&v, p, 4);
+            return v;
+        }
+
+        inline Bytes compress(const Bytes& in) {
+            Bytes out;
+            out.reserve(in.size() / 2 + 16);
+            std::vector<int64_t> table(size_t(1) << HASH_BITS, -1);
+            const uint8_t* src = in.data();
+            size_t n = in.size(), i = 0, anchor = 0;
+
+            while (i + MIN_MATCH <= n) {
+                uint32_t h = (read32(src + i) * 2654435761u) >> (32 - HASH_BITS);
+                int64_t cand = table[h];
+                table[h] = static_cast<int64_t>(i);
+                if (cand < 0 || i - cand > MAX_OFFSET || read32(src + cand) != read32(src + i)) {
+                    ++i;
+                    continue;
+                }
+                size_t len = MIN_MATCH;
+                while (i + len < n && src[cand + len] == src[i + len]) ++len;
+
+                put_varint(out, i - anchor);
+                out.insert(out.end(), src + anchor, src + i);
+                put_varint(out, len - MIN_MATCH);
+                put_varint(out, i - cand);
+                i += len;
+                anchor = i;
+            }
+            put_varint(out, n - anchor);
+            out.insert(out.end(), src + anchor, src + n);
+            return out;
+        }
+
+        inline Bytes decompress(const uint8_t* p, const uint8_t* end, size_t raw_size) {
+            Bytes out;
+            out.reserve(raw_size);
+            while (true) {
+                size_t lit = get_varint(p, end);
+                if (lit > size_t(end - p)) throw std::runtime_error("dropcopy: corrupt block");
+                out.insert(out.end(), p, p + lit);
+                p += lit;
+                if (p == end) break;
+                size_t len = get_varint(p, end) + MIN_MATCH;
+                size_t off = get_varint(p, end);
+                if (off == 0 || off > out.size()) throw std::runtime_error("dropcopy: corrupt block");
+                size_t from = out.size() - off;
+                for (size_t k = 0; k < len; ++k) out.push_back(out[from + k]);  // may overlap
+            }
+            if (out.size() != raw_size) throw std::runtime_error("dropcopy: block size mismatch");
+            return out;
+        }
+    }  // namespace lz
+
+    // --- per block metadata ---------------------------------------------------
+
+    struct Bloom {
+        uint64_t words[BLOOM_WORDS] = {};
+
+        void add(std::string_view id) {
+            uint64_t h = hash_id(id);
+            for (int k = 0; k < 3; ++k) {
+                auto bit = (h >> (k * 16)) % (BLOOM_WORDS * 64);
+                words[bit / 64] |= uint64_t(1) << (bit % 64);
+            }
+        }
+
+        bool maybe_contains(std::string_view id) const {
+            uint64_t h = hash_id(id);
+            for (int k = 0; k < 3; ++k) {
+                auto bit = (h >> (k * 16)) % (BLOOM_WORDS * 64);
+                if (!(words[bit / 64] & (uint64_t(1) << (bit % 64)))) return false;
+            }
+            return true;
+        }
+    };
+
+    struct BlockInfo {
+        uint64_t offset = 0;
+        int64_t ts_min = 0;
+        int64_t ts_max = 0;
+        uint32_t rows = 0;
+    };
+
+    // --- writer -----------------------------------------------------------------
+
+    class BlockBuilder {
+        std::vector<std::string> strings;
+        std::unordered_map<std::string, uint32_t> string_idx;
+        std::vector<std::string> symbols;
+        Bloom bloom;
+
+        std::vector<uint8_t> sym_col, flag_col;
+        std::vector<int64_t> ts_col;
+        Bytes price_col, qty_col, leaves_col, id_col, contra_col;
+        Price last_price = 0;
+
+        uint32_t intern(std::string_view s) {
+            auto [it, inserted] = string_idx.try_emplace(std::string(s), static_cast<uint32_t>(strings.size()));
+            if (inserted) strings.emplace_back(s);
+            return it->second;
+        }
+
+        uint8_t symbol_index(std::string_view s) {
+            for (size_t i = 0; i < symbols.size(); ++i)
+                if (symbols[i] == s) return static_cast<uint8_t>(i);
+            symbols.emplace_back(s);
+            return static_cast<uint8_t>(symbols.size() - 1);
+        }
+
+        template<typename T>
+        static void put(std::FILE* f, const T& v) {
+            if (std::fwrite(&v, sizeof(T), 1, f) != 1) throw std::runtime_error("dropcopy: write failed");
+        }
+
+    public:
+        // one block holds at most 255 distinct symbols, caller seals before that
+        static constexpr size_t MAX_SYMBOLS = 255;
+
+        size_t rows() const { return ts_col.size(); }
+
+        bool has_room_for(std::string_view symbol) const {
+            if (symbols.size() < MAX_SYMBOLS) return true;
+            for (auto& s : symbols) if (s == symbol) return true;
+            return false;
+        }
+
+        void append(const EngineEvent& ev) {
+            auto sym = ev.symbol.view();
+            auto id = ev.order_id.view();
+            auto contra = ev.contra_id.view();
+
+            sym_col.push_back(symbol_index(sym));
+            flag_col.push_back(static_cast<uint8_t>(
+                static_cast<uint8_t>(ev.type) |
+                (ev.side == Side::Sell ? 0x10 : 0) |
+                (ev.order_type == OrderType::Market ? 0x20 : 0) |
+                (ev.id_truncated ? 0x40 : 0) |
+                (ev.symbol_truncated ? 0x80 : 0)));
+            ts_col.push_back(ev.ts_us);
+            put_varint(price_col, zigzag(ev.price - last_price));
+            last_price = ev.price;
+            put_varint(qty_col, zigzag(ev.qty));
+            put_varint(leaves_col, zigzag(ev.leaves));
+            put_varint(id_col, intern(id));
+            put_varint(contra_col, contra.empty() ? 0 : intern(contra) + 1);
+            bloom.add(id);
+            if (!contra.empty()) bloom.add(contra);
+        }
+
+        // encode + compress + write, returns what goes in the index
+        BlockInfo flush(std::FILE* f) {
+            BlockInfo info;
+            info.offset = static_cast<uint64_t>(std::ftell(f));
+            info.rows = static_cast<uint32_t>(rows());
+            info.ts_min = *std::min_element(ts_col.begin(), ts_col.end());
+            info.ts_max = *std::max_element(ts_col.begin(), ts_col.end());
+
+            Bytes raw;
+            raw.reserve(price_col.size() * 6 + strings.size() * 8);
+            put_varint(raw, strings.size());
+            for (auto& s : strings) {
+                put_varint(raw, s.size());
+                raw.insert(raw.end(), s.begin(), s.end());
+            }
+            raw.insert(raw.end(), sym_col.begin(), sym_col.end());
+            raw.insert(raw.end(), flag_col.begin(), flag_col.end());
+            for (auto ts : ts_col) put_varint(raw, static_cast<uint64_t>(ts - info.ts_min));
+            for (auto* col : { &price_col, &qty_col, &leaves_col, &id_col, &contra_col })
+                raw.insert(raw.end(), col->begin(), col->end());
+
+            Bytes payload = lz::compress(raw);
+
+            put(f, BLOCK_MAGIC);
+            put(f, info.rows);
+            put(f, info.ts_min);
+            put(f, info.ts_max);
+            put(f, static_cast<uint32_t>(raw.size()));
+            put(f, static_cast<uint32_t>(payload.size()));
+            put(f, bloom);
+            put(f, static_cast<uint8_t>(symbols.size()));
+            for (auto& s : symbols) {
+                put(f, static_cast<uint8_t>(s.size()));
+                std::fwrite(s.data(), 1, s.size(), f);
+            }
+            if (std::fwrite(payload.data(), 1, payload.size(), f) != payload.size())
+                throw std::runtime_error("dropcopy: write failed");
+
+            *this = BlockBuilder();
+            return info;
+        }
+    };
+
+    // consumer thread side. not thread safe, one owner
+    class AuditWriter {
+        std::FILE* file = nullptr;
+        BlockBuilder block;
+        std::vector<BlockInfo> index;
+        size_t block_rows;
+
+        template<typename T>
+        void put(const T& v) {
+            if (std::fwrite(&v, sizeof(T), 1, file) != 1) throw std::runtime_error("dropcopy: write failed");
+        }
+
+    public:
+        AuditWriter(const std::string& path, size_t rows_per_block = 8192) : block_rows(rows_per_block) {
+            file = std::fopen(path.c_str(), "wb");
+            if (!file) throw std::runtime_error("dropcopy: can't open " + path);
+            std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+            put(FILE_MAGIC);
+            put(VERSION);
+        }
+
+        ~AuditWriter() { close(); }
+
+        AuditWriter(const AuditWriter&) = delete;
+        AuditWriter& operator=(const AuditWriter&) = delete;
+
+        void append(const EngineEvent& ev) {
+            if (!block.has_room_for(ev.symbol.view())) seal();
+            block.append(ev);
+            if (block.rows() >= block_rows) seal();
+        }
+
+        size_t pending_rows() const { return block.rows(); }
+
+        // write out a partial block (time based flush, shutdown)
+        void seal() {
+            if (block.rows() == 0) return;
+            index.push_back(block.flush(file));
+            std::fflush(file);
+        }
+
+        void close() {
+            if (!file) return;
+            seal();
+            uint64_t index_offset = static_cast<uint64_t>(std::ftell(file));
+            for (auto& b : index) {
+                put(b.offset);
+                put(b.ts_min);
+                put(b.ts_max);
+                put(b.rows);
+            }
+            put(index_offset);
+            put(static_cast<uint32_t>(index.size()));
+            put(INDEX_MAGIC);
+            std::fclose(file);
+            file = nullptr;
+        }
+    };
+
+    // --- reader -------------------------------------------------------------------
+
+    struct Filter {
+        std::optional<std::string> symbol;
+        std::optional<std::string> order_id;  // matches either side of a fill
+        int64_t from_us = INT64_MIN;
+        int64_t to_us = INT64_MAX;
+
+        // what an id / symbol looks like once stored. a longer query can only
+        // ever hit the cut down prefix of a row flagged as truncated
+        std::string_view stored_id() const {
+            return std::string_view(*order_id).substr(0, MAX_ORDER_ID_LEN);
+        }
+        std::string_view stored_symbol() const {
+            return std::string_view(*symbol).substr(0, MAX_SYMBOL_LEN);
+        }
+
+        bool matches(const EngineEvent& ev) const {
+            if (ev.ts_us < from_us || ev.ts_us > to_us) return false;
+            if (symbol) {
+                if (symbol->size() > MAX_SYMBOL_LEN && !ev.symbol_truncated) return false;
+                if (ev.symbol.view() != stored_symbol()) return false;
+            }
+            if (order_id) {
+                if (order_id->size() > MAX_ORDER_ID_LEN && !ev.id_truncated) return false;
+                auto id = stored_id();
+                if (ev.order_id.view() != id && ev.contra_id.view() != id) return false;
+            }
+            return true;
+        }
+    };
+
+    struct ScanStats {
+        size_t blocks = 0;
+        size_t blocks_decoded = 0;
+        size_t rows_decoded = 0;
+        size_t rows_matched = 0;
+    };
+
+    class AuditReader {
+        std::FILE* file = nullptr;
+        std::vector<BlockInfo> index;
+
+        template<typename T>
+        bool get(T& v) { return std::fread(&v, sizeof(T), 1, file) == 1; }
+
+        void must(bool ok) { if (!ok) throw std::runtime_error("dropcopy: truncated file"); }
+
+        bool load_index() {
+            if (std::fseek(file, -16, SEEK_END) != 0) return false;
+            uint64_t index_offset;
+            uint32_t n, magic;
+            if (!get(index_offset) || !get(n) || !get(magic) || magic != INDEX_MAGIC) return false;
+            std::fseek(file, static_cast<long>(index_offset), SEEK_SET);
+            index.resize(n);
+            for (auto& b : index)
+                must(get(b.offset) && get(b.ts_min) && get(b.ts_max) && get(b.rows));
+            return true;
+        }
+
+        // no index (writer died), walk the block headers instead
+        void scan_headers() {
+            index.clear();
+            std::fseek(file, 8, SEEK_SET);
+            while (true) {
+                BlockInfo b;
+                b.offset = static_cast<uint64_t>(std::ftell(file));
+                uint32_t magic, raw, payload;
+                if (!get(magic) || magic != BLOCK_MAGIC) break;
+                if (!get(b.rows) || !get(b.ts_min) || !get(b.ts_max) || !get(raw) || !get(payload)) break;
+                std::fseek(file, sizeof(Bloom), SEEK_CUR);
+                uint8_t n_syms, len;
+                if (!get(n_syms)) break;
+                for (int i = 0; i < n_syms; ++i) {
+                    if (!get(len)) break;
+                    std::fseek(file, len, SEEK_CUR);
+                }
+                long end = std::ftell(file) + static_cast<long>(payload);
+                std::fseek(file, 0, SEEK_END);
+                if (std::ftell(file) < end) break;  // torn last block
+                std::fseek(file, end, SEEK_SET);
+                index.push_back(b);
+            }
+        }
+
+        static void decode(const Bytes& raw, uint32_t rows, int64_t ts_min,
+            const std::vector<std::string>& symbols, std::vector<EngineEvent>& out) {
+            const uint8_t* p = raw.data();
+            const uint8_t* end = p + raw.size();
+
+            std::vector<std::string_view> strings(get_varint(p, end));
+            for (auto& s : strings) {
+                size_t len = get_varint(p, end);
+                if (len > size_t(end - p)) throw std::runtime_error("dropcopy: corrupt block");
+                s = std::string_view(reinterpret_cast<const char*>(p), len);
+                p += len;
+            }
+            auto string_at = [&](uint64_t i) {
+                if (i >= strings.size()) throw std::runtime_error("dropcopy: corrupt block");
+                return strings[i];
+            };
+
+            if (size_t(end - p) < size_t(rows) * 2) throw std::runtime_error("dropcopy: corrupt block");
+            out.assign(rows, EngineEvent{});
+            for (auto& ev : out) {
+                uint8_t s = *p++;
+                if (s >= symbols.size()) throw std::runtime_error("dropcopy: corrupt block");
+                ev.symbol.assign(symbols[s]);
+            }
+            for (auto& ev : out) {
+                uint8_t f = *p++;
+                ev.type = static_cast<EventType>(f & 0x0f);
+                ev.side = (f & 0x10) ? Side::Sell : Side::Buy;
+                ev.order_type = (f & 0x20) ? OrderType::Market : OrderType::Limit;
+                ev.id_truncated = (f & 0x40) != 0;
+                ev.symbol_truncated = (f & 0x80) != 0;
+            }
+            for (auto& ev : out) ev.ts_us = ts_min + static_cast<int64_t>(get_varint(p, end));
+            Price last = 0;
+            for (auto& ev : out) ev.price = last = last + unzigzag(get_varint(p, end));
+            for (auto& ev : out) ev.qty = unzigzag(get_varint(p, end));
+            for (auto& ev : out) ev.leaves = unzigzag(get_varint(p, end));
+            for (auto& ev : out) ev.order_id.assign(string_at(get_varint(p, end)));
+            for (auto& ev : out) {
+                auto c = get_varint(p, end);
+                if (c) ev.contra_id.assign(string_at(c - 1));
+            }
+        }
+
+    public:
+        explicit AuditReader(const std::string& path) {
+            file = std::fopen(path.c_str(), "rb");
+            if (!file) throw std::runtime_error("dropcopy: can't open " + path);
+            uint32_t magic, version;
+            must(get(magic) && get(version));
+            if (magic != FILE_MAGIC) throw std::runtime_error("dropcopy: not a drop copy file: " + path);
+            if (version != VERSION) throw std::runtime_error("dropcopy: unsupported version");
+            if (!load_index()) scan_headers();
+        }
+
+        ~AuditReader() { if (file) std::fclose(file); }
+
+        AuditReader(const AuditReader&) = delete;
+        AuditReader& operator=(const AuditReader&) = delete;
+
+        const std::vector<BlockInfo>& blocks() const { return index; }
+
+        // time range comes from the index, symbol / order id from the block
+        // header. only blocks that survive both get their payload read and
+        // decompressed
+        ScanStats scan(const Filter& filter, const std::function<void(const EngineEvent&)>& fn) {
+            ScanStats stats;
+            std::vector<EngineEvent> rows;
+            for (auto& b : index) {
+                ++stats.blocks;
+                if (b.ts_max < filter.from_us || b.ts_min > filter.to_us) continue;
+
+                std::fseek(file, static_cast<long>(b.offset), SEEK_SET);
+                uint32_t magic, count, raw_bytes, payload_bytes;
+                int64_t ts_min, ts_max;
+                Bloom bloom;
+                must(get(magic) && magic == BLOCK_MAGIC);
+                must(get(count) && get(ts_min) && get(ts_max) && get(raw_bytes) && get(payload_bytes) && get(bloom));
+                if (filter.order_id && !bloom.maybe_contains(filter.stored_id())) continue;
+
+                uint8_t n_syms;
+                must(get(n_syms));
+                std::vector<std::string> symbols(n_syms);
+                for (auto& s : symbols) {
+                    uint8_t len;
+                    must(get(len));
+                    s.resize(len);
+                    must(std::fread(s.data(), 1, len, file) == len);
+                }
+                if (filter.symbol && std::find(symbols.begin(), symbols.end(), filter.stored_symbol()) == symbols.end())
+                    continue;
+
+                Bytes payload(payload_bytes);
+                must(std::fread(payload.data(), 1, payload_bytes, file) == payload_bytes);
+                Bytes raw = lz::decompress(payload.data(), payload.data() + payload.size(), raw_bytes);
+                decode(raw, count, ts_min, symbols, rows);
+
+                ++stats.blocks_decoded;
+                stats.rows_decoded += rows.size();
+                for (auto& ev : rows) {
+                    if (!filter.matches(ev)) continue;
+                    ++stats.rows_matched;
+                    fn(ev);
+                }
+            }
+            return stats;
+        }
+    };
+
+    // --- the engine facing bit --------------------------------------------------------
+
+    // EventListener that hands events to a dropcopy runtime thread. on_event is
+    // called on the match thread and never blocks: if the ring is full the
+    // event goes into a local spill list that gets retried first on the next
+    // event (or on close), so nothing is lost and ordering is kept.
+    class DropCopy : public EventListener {
+        struct Shared {
+            // ring lives in the dropcopy worker's node local arena. we keep the
+            // arena alive ourselves so the ring stays valid even if the
+            // runtime is torn down before we are
+            std::shared_ptr<runtime::NodeArena> arena;
+            SpscQueue<EngineEvent>* queue = nullptr;
+            std::unique_ptr<AuditWriter> writer;
+            std::atomic<bool> closing{false};
+            std::atomic<bool> closed{false};
+            std::atomic<bool> worker_gone{false};  // consumer thread exited, won't touch writer again
+            std::atomic<uint64_t> written{0};
+            std::atomic<uint64_t> truncated{0};
+
+            void append(const EngineEvent& ev) {
+                writer->append(ev);
+                if (ev.id_truncated || ev.symbol_truncated) truncated.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            ~Shared() { if (queue) queue->~SpscQueue(); }
+        };
+
+        std::shared_ptr<Shared> shared;
+        std::deque<EngineEvent> spill;  // match thread only
+        uint64_t spilled = 0;
+
+        bool drain_spill() {
+            while (!spill.empty()) {
+                if (!shared->queue->try_push(spill.front())) return false;
+                spill.pop_front();
+            }
+            return true;
+        }
+
+        // consumer thread is dead (runtime stopped first): this thread is the
+        // only one left, so finish the queue and spill list into the file here
+        void take_over() {
+            EngineEvent ev;
+            uint64_t n = 0;
+            while (shared->queue->try_pop(ev)) { shared->append(ev); ++n; }
+            for (auto& e : spill) { shared->append(e); ++n; }
+            spill.clear();
+            shared->written.fetch_add(n, std::memory_order_relaxed);
+        }
+
+    public:
+        static constexpr size_t DEFAULT_QUEUE = 1 << 16;
+        static constexpr size_t DEFAULT_BLOCK_ROWS = 8192;
+        static constexpr auto MAX_BLOCK_AGE = std::chrono::milliseconds(250);
+
+        DropCopy(runtime::Runtime& rt, const std::string& path,
+            size_t queue_capacity = DEFAULT_QUEUE, size_t block_rows = DEFAULT_BLOCK_ROWS)
+            : shared(std::make_shared<Shared>()) {
+            shared->writer = std::make_unique<AuditWriter>(path, block_rows);
+
+            rt.spawn(runtime::Role::DropCopy, [s = shared, queue_capacity](runtime::WorkerContext& ctx) {
+                s->arena = ctx.arena;
+                s->queue = ctx.arena->make_queue<EngineEvent>(queue_capacity);
+                ctx.on_exit = [s] { s->worker_gone.store(true, std::memory_order_release); };
+                auto oldest = std::chrono::steady_clock::now();
+
+                return runtime::PollFn([s, oldest]() mutable {
+                    if (s->closed.load(std::memory_order_relaxed)) return false;
+
+                    EngineEvent ev;
+                    size_t n = 0;
+                    while (n < 1024 && s->queue->try_pop(ev)) {
+                        if (s->writer->pending_rows() == 0) oldest = std::chrono::steady_clock::now();
+                        s->append(ev);
+                        ++n;
+                    }
+                    if (n) {
+                        s->written.fetch_add(n, std::memory_order_relaxed);
+                        return true;
+                    }
+
+                    if (s->closing.load(std::memory_order_acquire)) {
+                        // producer is done, anything pushed before closing is visible now
+                        uint64_t rest = 0;
+                        while (s->queue->try_pop(ev)) { s->append(ev); ++rest; }
+                        s->written.fetch_add(rest, std::memory_order_relaxed);
+                        s->writer->close();
+                        s->closed.store(true, std::memory_order_release);
+                        return true;
+                    }
+
+                    // quiet period, don't sit on a half block forever
+                    if (s->writer->pending_rows() &&
+                        std::chrono::steady_clock::now() - oldest > MAX_BLOCK_AGE)
+                        s->writer->seal();
+                    return false;
+                });
+            });
+        }
+
+        ~DropCopy() override { close(); }
+
+        DropCopy(const DropCopy&) = delete;
+        DropCopy& operator=(const DropCopy&) = delete;
+
+        void on_event(const EngineEvent& ev) override {
+            if (shared->worker_gone.load(std::memory_order_acquire)) {
+                // nobody is reading the ring anymore, write it ourselves
+                if (shared->closed.load(std::memory_order_acquire)) return;
+                take_over();
+                shared->append(ev);
+                shared->written.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (drain_spill() && shared->queue->try_push(ev)) return;
+            spill.push_back(ev);
+            ++spilled;
+        }
+
+        // match thread side: flush the spill list, then have the writer finish
+        // the file. if the runtime was already stopped (or stops while we wait)
+        // the writer gets finished on this thread instead, so this never hangs
+        void close() {
+            auto& s = *shared;
+            if (s.closed.load(std::memory_order_acquire)) return;
+            while (!drain_spill()) {
+                if (s.worker_gone.load(std::memory_order_acquire)) break;
+                runtime::cpu_relax();
+            }
+            s.closing.store(true, std::memory_order_release);
+            while (!s.closed.load(std::memory_order_acquire)) {
+                if (s.worker_gone.load(std::memory_order_acquire)) {
+                    if (s.closed.load(std::memory_order_acquire)) break;
+                    take_over();
+                    s.writer->close();
+                    s.closed.store(true, std::memory_order_release);
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        uint64_t events_written() const { return shared->written.load(std::memory_order_relaxed); }
+
+        // events that found the ring full. non zero means the consumer couldn't
+        // keep up for a bit, size the queue up
+        uint64_t events_spilled() const { return spilled; }
+
+        // events with an id or symbol cut to MAX_ORDER_ID_LEN / MAX_SYMBOL_LEN.
+        // the gateway refuses those, so anything here came in around it.
+        // they're flagged in the file too
+        uint64_t events_truncated() const { return shared->truncated.load(std::memory_order_relaxed); }
+    };
+
+}  // namespace trading::dropcopy
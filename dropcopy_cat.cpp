@@ -0,0 +1,70 @@
+#include "dropcopy.hpp"
+#include "fix.hpp"
+#include <cstring>
+#include <iostream>
+
+// dump / filter a drop copy file without unpacking blocks that can't match
+//   dropcopy_cat FILE [--symbol SYM] [--order ID] [--from US] [--to US] [--stats]
+int main(int argc, char** argv) {
+    using namespace trading;
+
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0]
+            << " FILE [--symbol SYM] [--order ID] [--from US] [--to US] [--stats]\n";
+        return 1;
+    }
+
+    dropcopy::Filter filter;
+    bool show_stats = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("missing value for " + arg);
+            return argv[++i];
+        };
+        try {
+            if (arg == "--symbol") filter.symbol = next();
+            else if (arg == "--order") filter.order_id = next();
+            else if (arg == "--from") filter.from_us = std::stoll(next());
+            else if (arg == "--to") filter.to_us = std::stoll(next());
+            else if (arg == "--stats") show_stats = true;
+            else throw std::runtime_error("unknown arg " + arg);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    try {
+        dropcopy::AuditReader reader(argv[1]);
+        uint64_t truncated = 0;
+        auto stats = reader.scan(filter, [&truncated](const EngineEvent& ev) {
+            std::cout << CoarseClock::format(CoarseClock::TimePoint(std::chrono::microseconds(ev.ts_us)))
+                << " " << event_type_name(ev.type)
+                << " " << ev.symbol.view()
+                << " " << ev.order_id.view()
+                << " " << (ev.side == Side::Buy ? "buy" : "sell")
+                << " " << ev.qty << " @ "
+                << (ev.order_type == OrderType::Market && ev.type != EventType::Fill ?
+                    std::string("MKT") : fix::price_to_string(ev.price))
+                << " leaves " << ev.leaves;
+            if (!ev.contra_id.empty()) std::cout << " vs " << ev.contra_id.view();
+            if (ev.id_truncated) std::cout << " (id truncated)";
+            if (ev.symbol_truncated) std::cout << " (symbol truncated)";
+            if (ev.id_truncated || ev.symbol_truncated) ++truncated;
+            std::cout << "\n";
+        });
+
+        if (show_stats) {
+            std::cerr << "blocks " << stats.blocks
+                << " decoded " << stats.blocks_decoded
+                << " rows " << stats.rows_decoded
+                << " matched " << stats.rows_matched
+                << " truncated " << truncated << "\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "bruh: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,479 @@
+#pragma once
+#include "types.hpp"
+#include "clock.hpp"
+#include "events.hpp"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace trading {
+
+    // fr fr no cap logging utility
+    class Logger {
+        // UTC HH:MM:SS.mmm off the cached clock, no localtime() per line
+        static inline std::string get_time() { return CoarseClock::time_of_day(); }
+
+    public:
+        // replay / benchmarks turn this off, stdout is not what we're measuring
+        static inline bool enabled = true;
+
+        template<typename... Args>
+        static void log(const Args&... args) {
+            if (!enabled) return;
+            std::stringstream ss;
+            ss << "[" << get_time() << "] ";
+            (ss << ... << args);
+            std::cout << ss.str() << std::endl;
+        }
+    };
+
+    template<typename PriceComparator>
+    class OrderBook {
+    public:
+        using OrderPtr = std::shared_ptr<Order>;
+        using OrderList = std::list<OrderPtr>;
+
+        // qty is the sum of remaining() over the level, kept up to date on
+        // every add / remove / fill so depth questions (auction uncross) are
+        // per level instead of per order
+        struct Level {
+            OrderList orders;
+            Quantity qty = 0;
+        };
+        using OrderMap = std::map<Price, Level, PriceComparator>;
+
+    private:
+        OrderMap orders;
+        std::string symbol;
+
+    public:
+        OrderBook(std::string sym) : symbol(std::move(sym)) {}
+
+        void add(const OrderPtr& order) {
+            auto& level = orders[order->price];
+            level.orders.push_back(order);
+            level.qty += order->remaining();
+            Logger::log("added order ", order->id, " @ ", order->price / 10000.0);
+        }
+
+        // false if it wasn't resting here
+        bool remove(const OrderPtr& order) {
+            auto level = orders.find(order->price);
+            if (level == orders.end()) return false;
+            auto& list = level->second.orders;
+            auto before = list.size();
+            list.remove(order);
+            bool found = list.size() != before;
+            if (found) level->second.qty -= order->remaining();
+            if (list.empty()) orders.erase(level);
+            if (found) Logger::log("removed order ", order->id);
+            return found;
+        }
+
+        OrderPtr best() const {
+            if (orders.empty()) return nullptr;
+            const auto& best_list = orders.begin()->second.orders;
+            return best_list.empty() ? nullptr : best_list.front();
+        }
+
+        // best() just traded qty, keep the level total honest
+        void reduce_best(Quantity qty) { orders.begin()->second.qty -= qty; }
+
+        // best() without the shared_ptr copy, for loops that don't keep it
+        Order* peek_best() const {
+            if (orders.empty()) return nullptr;
+            const auto& best_list = orders.begin()->second.orders;
+            return best_list.empty() ? nullptr : best_list.front().get();
+        }
+
+        // like pop_best(), but the node moves to `out` instead of being freed
+        // here, so a burst of fills (auction uncross) doesn't pay for a free
+        // per fill. also prefetches the next order up, it's the next to fill
+        void retire_best(OrderList& out) {
+            auto level = orders.begin();
+            auto& list = level->second.orders;
+            if (Logger::enabled) Logger::log("removed order ", list.front()->id);
+            level->second.qty -= list.front()->remaining();
+            out.splice(out.end(), list, list.begin());
+            if (!list.empty()) {
+                auto next = list.begin();
+                __builtin_prefetch(next->get());
+                if (++next != list.end()) __builtin_prefetch(&*next);
+            }
+            if (list.empty()) orders.erase(level);
+        }
+
+        // drop best() without the list scan remove() does
+        void pop_best() {
+            auto level = orders.begin();
+            auto& list = level->second.orders;
+            if (Logger::enabled) Logger::log("removed order ", list.front()->id);
+            level->second.qty -= list.front()->remaining();
+            list.pop_front();
+            if (list.empty()) orders.erase(level);
+        }
+
+        const OrderMap& levels() const { return orders; }
+        bool empty() const { return orders.empty(); }
+
+        // no cap this is useful for debugging
+        void print_state() const {
+            for (const auto& [price, level] : this->orders) {
+                std::stringstream ss;
+                ss << std::fixed << std::setprecision(2) << price / 10000.0 << ": ";
+                for (const auto& order : level.orders) {
+                    ss << order->id << "(" << order->remaining() << ") ";
+                }
+                Logger::log(ss.str());
+            }
+        }
+    };
+
+    enum class TradingMode { Continuous, Auction };
+
+    struct AuctionResult {
+        bool crossed = false;    // false = nothing executable, no price
+        Price price = 0;
+        Quantity volume = 0;
+        Quantity imbalance = 0;  // eligible buy qty - sell qty at price, + = buy surplus
+    };
+
+    class MatchingEngine {
+        // min heap for asks (selling), max heap for bids (buying)
+        using AskBook = OrderBook<std::less<Price>>;
+        using BidBook = OrderBook<std::greater<Price>>;
+        using OrderQueue = std::deque<std::shared_ptr<Order>>;
+        AskBook asks;
+        BidBook bids;
+        EventListener* listener = nullptr;
+
+        // auction call period: limit orders rest in the books (crossed is fine),
+        // market orders wait here and get first dibs at the uncross
+        TradingMode mode = TradingMode::Continuous;
+        OrderQueue auction_buys;
+        OrderQueue auction_sells;
+
+        static int64_t to_us(std::chrono::system_clock::time_point tp) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+        }
+
+        void emit(EventType type, const Order& order, Price price, Quantity qty,
+            Quantity leaves, int64_t ts_us, const Order* contra = nullptr) {
+            if (!listener) return;
+            EngineEvent ev;
+            ev.type = type;
+            ev.side = order.side;
+            ev.order_type = order.type;
+            ev.ts_us = ts_us;
+            ev.price = price;
+            ev.qty = qty;
+            ev.leaves = leaves;
+            ev.symbol_truncated = !ev.symbol.assign(order.symbol);
+            ev.id_truncated = !ev.order_id.assign(order.id);
+            if (contra && !ev.contra_id.assign(contra->id)) ev.id_truncated = true;
+            listener->on_event(ev);
+        }
+
+        void match(std::shared_ptr<Order>& incoming) {
+            if (incoming->side == Side::Buy) {
+                match_order(incoming, asks, bids);
+            } else {
+                match_order(incoming, bids, asks);
+            }
+        }
+
+        template<typename ContraBook, typename SameBook>
+        void match_order(std::shared_ptr<Order>& incoming,
+            ContraBook& contra_book,
+            SameBook& same_book) {
+
+            Logger::log(
+                "matching ", incoming->id, " ",
+                incoming->side == Side::Buy ? "buy" : "sell", " ",
+                incoming->qty, " @ ",
+                incoming->type == OrderType::Market ? "MKT" :
+                std::to_string(incoming->price / 10000.0)
+            );
+
+            while (!incoming->is_filled()) {
+                auto resting = contra_book.best();
+                if (!resting || !price_matches(incoming, resting)) break;
+
+                auto match_qty = std::min(incoming->remaining(), resting->remaining());
+                execute_match(incoming, resting, match_qty);
+                contra_book.reduce_best(match_qty);
+
+                if (resting->is_filled())
+                    contra_book.pop_best();
+            }
+
+            if (!incoming->is_filled() && incoming->type == OrderType::Limit)
+                same_book.add(incoming);
+
+            // market orders don't rest, whatever is left gets killed
+            if (!incoming->is_filled() && incoming->type == OrderType::Market) {
+                emit(EventType::Cancel, *incoming, incoming->price, incoming->remaining(), 0,
+                    to_us(incoming->timestamp));
+            }
+
+
+            if (Logger::enabled) {
+                Logger::log("post-match state:");
+                Logger::log("asks:");
+                asks.print_state();
+                Logger::log("bids:");
+                bids.print_state();
+            }
+        }
+
+        bool price_matches(const std::shared_ptr<Order>& incoming,
+            const std::shared_ptr<Order>& resting) {
+            if (incoming->type == OrderType::Market) return true;
+            return incoming->side == Side::Buy ?
+                incoming->price >= resting->price :
+                incoming->price <= resting->price;
+        }
+
+        void execute_match(std::shared_ptr<Order>& incoming,
+            std::shared_ptr<Order>& resting,
+            Quantity qty) {
+            incoming->filled += qty;
+            resting->filled += qty;
+            // fills are stamped with the aggressor's transact time so the
+            // event stream is a pure function of the input (replayable)
+            emit(EventType::Fill, *incoming, resting->price, qty, incoming->remaining(),
+                to_us(incoming->timestamp), resting.get());
+            if (Logger::enabled)
+                Logger::log(
+                    "match: ", incoming->id, " vs ", resting->id,
+                    " for ", qty, " @ ", resting->price / 10000.0
+                );
+        }
+
+        static Quantity queued_qty(const OrderQueue& q) {
+            Quantity total = 0;
+            for (const auto& o : q) total += o->remaining();
+            return total;
+        }
+
+        // one trade at the auction price. the buy side goes in order_id so the
+        // event stream doesn't depend on who "aggressed"
+        void execute_auction_fill(Order& buy, Order& sell, Price price, Quantity qty, int64_t ts_us) {
+            buy.filled += qty;
+            sell.filled += qty;
+            emit(EventType::Fill, buy, price, qty, buy.remaining(), ts_us, &sell);
+            if (Logger::enabled)
+                Logger::log("auction match: ", buy.id, " vs ", sell.id, " for ", qty, " @ ", price / 10000.0);
+        }
+
+        // fill `volume` at `price` in one walk down both sides: market orders
+        // first, then the books in price-time priority. volume came from the
+        // depth curves so there's always enough eligible qty on both sides.
+        // filled orders go to `retired` rather than being freed one by one
+        // in here, the caller lets go of them after the fills are out
+        void execute_auction(Price price, Quantity volume, int64_t ts_us, AskBook::OrderList& retired) {
+            Quantity left = volume;
+            while (left > 0) {
+                bool buy_mkt = !auction_buys.empty();
+                bool sell_mkt = !auction_sells.empty();
+                Order* buy = buy_mkt ? auction_buys.front().get() : bids.peek_best();
+                Order* sell = sell_mkt ? auction_sells.front().get() : asks.peek_best();
+                if (!buy || !sell) break;  // curves and books disagree, shouldn't happen
+
+                auto qty = std::min({ buy->remaining(), sell->remaining(), left });
+                execute_auction_fill(*buy, *sell, price, qty, ts_us);
+                left -= qty;
+
+                if (buy_mkt) {
+                    if (buy->is_filled()) {
+                        retired.push_back(std::move(auction_buys.front()));
+                        auction_buys.pop_front();
+                    }
+                } else {
+                    bids.reduce_best(qty);
+                    if (buy->is_filled()) bids.retire_best(retired);
+                }
+                if (sell_mkt) {
+                    if (sell->is_filled()) {
+                        retired.push_back(std::move(auction_sells.front()));
+                        auction_sells.pop_front();
+                    }
+                } else {
+                    asks.reduce_best(qty);
+                    if (sell->is_filled()) asks.retire_best(retired);
+                }
+            }
+        }
+
+        // market orders don't carry over into continuous trading
+        void cancel_queued(OrderQueue& q, int64_t ts_us) {
+            for (const auto& o : q)
+                emit(EventType::Cancel, *o, o->price, o->remaining(), 0, ts_us);
+            q.clear();
+        }
+
+    public:
+        MatchingEngine(std::string symbol) : asks(symbol), bids(symbol) {}
+
+        // not owned, has to outlive the engine (or be reset to null)
+        void set_listener(EventListener* l) { listener = l; }
+
+        TradingMode get_mode() const { return mode; }
+
+        void handle(std::shared_ptr<Order> order) {
+            emit(EventType::New, *order, order->price, order->qty, order->remaining(), to_us(order->timestamp));
+            if (mode == TradingMode::Auction) {
+                if (order->type == OrderType::Market)
+                    (order->side == Side::Buy ? auction_buys : auction_sells).push_back(order);
+                else if (order->side == Side::Buy)
+                    bids.add(order);
+                else
+                    asks.add(order);
+                return;
+            }
+            match(order);
+        }
+
+        // pull a resting order. false if it isn't on the book (filled, already
+        // cancelled, or a market order that never rested)
+        bool cancel(const std::shared_ptr<Order>& order,
+            std::chrono::system_clock::time_point ts = CoarseClock::now()) {
+            bool removed = order->side == Side::Buy ? bids.remove(order) : asks.remove(order);
+            if (!removed && mode == TradingMode::Auction && order->type == OrderType::Market) {
+                auto& q = order->side == Side::Buy ? auction_buys : auction_sells;
+                auto it = std::find(q.begin(), q.end(), order);
+                if (it != q.end()) {
+                    q.erase(it);
+                    removed = true;
+                }
+            }
+            if (removed)
+                emit(EventType::Cancel, *order, order->price, order->remaining(), 0, to_us(ts));
+            return removed;
+        }
+
+        // opening / closing call: stop matching, just collect orders until uncross()
+        void start_auction() {
+            mode = TradingMode::Auction;
+            Logger::log("auction call started");
+        }
+
+        // the price uncross() would print right now. walks the aggregated level
+        // depth once (O(levels), not O(orders)): for every limit price p,
+        // demand = market buys + bids >= p and supply = market sells + asks <= p.
+        // winner is max min(demand, supply), then smallest |imbalance|, then
+        // market pressure (buy surplus -> highest price, sell surplus -> lowest),
+        // then closest to reference (if given, else the middle of the tie)
+        AuctionResult indicative(Price reference = 0) const {
+            struct Depth { Price price; Quantity qty; };
+            std::vector<Depth> ask_depth, bid_depth;
+            ask_depth.reserve(asks.levels().size());
+            bid_depth.reserve(bids.levels().size());
+            for (const auto& [price, level] : asks.levels()) ask_depth.push_back({ price, level.qty });
+            for (const auto& [price, level] : bids.levels()) bid_depth.push_back({ price, level.qty });
+            std::reverse(bid_depth.begin(), bid_depth.end());  // ascending like the asks
+
+            Quantity market_buy = queued_qty(auction_buys);
+            Quantity market_sell = queued_qty(auction_sells);
+            Quantity total_demand = market_buy;
+            for (const auto& d : bid_depth) total_demand += d.qty;
+
+            AuctionResult best;
+            std::vector<AuctionResult> ties;
+            auto consider = [&](Price p, Quantity demand, Quantity supply) {
+                AuctionResult r{ true, p, std::min(demand, supply), demand - supply };
+                if (r.volume <= 0) return;
+                auto abs_imb = r.imbalance < 0 ? -r.imbalance : r.imbalance;
+                auto best_imb = best.imbalance < 0 ? -best.imbalance : best.imbalance;
+                if (!best.crossed || r.volume > best.volume ||
+                    (r.volume == best.volume && abs_imb < best_imb)) {
+                    best = r;
+                    ties.assign(1, r);
+                } else if (r.volume == best.volume && abs_imb == best_imb) {
+                    ties.push_back(r);
+                }
+            };
+
+            if (ask_depth.empty() && bid_depth.empty()) {
+                // only market orders, nothing to price off except the reference
+                if (reference > 0) consider(reference, market_buy, market_sell);
+            } else {
+                size_t a = 0, b = 0;
+                Quantity supply = market_sell;  // asks priced <= p
+                Quantity below = 0;             // bids priced < p
+                while (a < ask_depth.size() || b < bid_depth.size()) {
+                    Price p = a == ask_depth.size() ? bid_depth[b].price :
+                        b == bid_depth.size() ? ask_depth[a].price :
+                        std::min(ask_depth[a].price, bid_depth[b].price);
+                    while (a < ask_depth.size() && ask_depth[a].price == p) supply += ask_depth[a++].qty;
+                    consider(p, total_demand - below, supply);
+                    while (b < bid_depth.size() && bid_depth[b].price == p) below += bid_depth[b++].qty;
+                }
+            }
+
+            if (ties.size() <= 1) return best;
+
+            // ties are in ascending price order
+            bool all_buy = std::all_of(ties.begin(), ties.end(), [](auto& t) { return t.imbalance > 0; });
+            bool all_sell = std::all_of(ties.begin(), ties.end(), [](auto& t) { return t.imbalance < 0; });
+            if (all_buy) return ties.back();
+            if (all_sell) return ties.front();
+            if (reference <= 0) return ties[(ties.size() - 1) / 2];
+            return *std::min_element(ties.begin(), ties.end(), [&](auto& x, auto& y) {
+                auto dx = x.price > reference ? x.price - reference : reference - x.price;
+                auto dy = y.price > reference ? y.price - reference : reference - y.price;
+                return dx < dy;
+            });
+        }
+
+        // frees what execute_auction() retired. those orders have gone cold
+        // by now, so prefetch a few ahead rather than miss on every one
+        static void release(AskBook::OrderList& retired) {
+            auto ahead = retired.begin();
+            for (int i = 0; i < 8 && ahead != retired.end(); ++i, ++ahead)
+                __builtin_prefetch(ahead->get(), 1);
+            while (!retired.empty()) {
+                if (ahead != retired.end()) __builtin_prefetch((ahead++)->get(), 1);
+                retired.pop_front();
+            }
+        }
+
+        // print the auction: everything executable trades at one price, left
+        // over market orders are cancelled, and we're back to continuous
+        AuctionResult uncross(Price reference = 0,
+            std::chrono::system_clock::time_point ts = CoarseClock::now()) {
+            AuctionResult result;
+            if (mode != TradingMode::Auction) return result;
+
+            result = indicative(reference);
+            auto ts_us = to_us(ts);
+            AskBook::OrderList retired;  // released after the fills and the print
+            if (result.crossed) execute_auction(result.price, result.volume, ts_us, retired);
+            cancel_queued(auction_buys, ts_us);
+            cancel_queued(auction_sells, ts_us);
+            mode = TradingMode::Continuous;
+
+            if (Logger::enabled) {
+                if (result.crossed)
+                    Logger::log("uncrossed ", result.volume, " @ ", result.price / 10000.0,
+                        " imbalance ", result.imbalance);
+                else
+                    Logger::log("auction ended, nothing crossed");
+                Logger::log("asks:");
+                asks.print_state();
+                Logger::log("bids:");
+                bids.print_state();
+            }
+            release(retired);
+            return result;
+        }
+    };
+}  // namespace trading
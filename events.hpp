@@ -0,0 +1,72 @@
+#pragma once
+#include "types.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// what the matching engine tells the outside world. plain fixed size structs
+// so they can go through an spsc ring without allocating on the match thread
+namespace trading {
+
+    template<size_t N>
+    struct FixedString {
+        char data[N] = {};
+
+        FixedString() = default;
+        FixedString(std::string_view s) { assign(s); }
+
+        // longer stuff gets truncated to N - 1 chars, returns false when that happened
+        bool assign(std::string_view s) {
+            size_t n = std::min(s.size(), N - 1);
+            std::memcpy(data, s.data(), n);
+            std::memset(data + n, 0, N - n);
+            return n == s.size();
+        }
+
+        std::string_view view() const { return std::string_view(data, strnlen(data, N)); }
+        bool empty() const { return data[0] == '\0'; }
+    };
+
+    // longest ClOrdID / symbol we carry. the gateway rejects anything longer,
+    // so they only get cut if an order reached the engine some other way, and
+    // then the event says so (id_truncated / symbol_truncated)
+    constexpr size_t MAX_ORDER_ID_LEN = 63;
+    constexpr size_t MAX_SYMBOL_LEN = 15;
+    using EventId = FixedString<MAX_ORDER_ID_LEN + 1>;
+    using EventSymbol = FixedString<MAX_SYMBOL_LEN + 1>;
+
+    enum class EventType : uint8_t { New, Fill, Cancel };
+
+    inline const char* event_type_name(EventType t) {
+        switch (t) {
+            case EventType::New: return "NEW";
+            case EventType::Fill: return "FILL";
+            case EventType::Cancel: return "CANCEL";
+        }
+        return "?";
+    }
+
+    struct EngineEvent {
+        EventType type = EventType::New;
+        Side side = Side::Buy;               // of order_id
+        OrderType order_type = OrderType::Limit;
+        int64_t ts_us = 0;                   // transact time, micros since epoch
+        Price price = 0;                     // order price for NEW/CANCEL, exec price for FILL
+        Quantity qty = 0;                    // order qty for NEW, exec qty for FILL, cancelled qty for CANCEL
+        Quantity leaves = 0;                 // order_id's remaining qty after this event
+        EventSymbol symbol;
+        EventId order_id;
+        EventId contra_id;                   // resting side of a FILL, empty otherwise
+        bool id_truncated = false;           // order_id or contra_id was over MAX_ORDER_ID_LEN
+        bool symbol_truncated = false;       // symbol was over MAX_SYMBOL_LEN
+    };
+
+    class EventListener {
+    public:
+        virtual ~EventListener() = default;
+        virtual void on_event(const EngineEvent& ev) = 0;
+    };
+
+}  // namespace trading
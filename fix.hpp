@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <stdexcept>
@@ -7,6 +8,7 @@
 #include <chrono>
 #include <iomanip>
 #include <iostream>
+#include "clock.hpp"
 
 namespace fix {
 
@@ -79,19 +81,63 @@ namespace fix {
         static constexpr char Sell = '2';
     };
 
+    // biggest body we'll frame. far more than any message we take, small
+    // enough that a garbage length can't make a framer buffer forever
+    constexpr size_t MAX_BODY_LENGTH = 64 * 1024;
+
+    // size of the message at the front of data, BeginString through the
+    // CheckSum SOH, going by BodyLength (9=). 0 if it isn't all there yet,
+    // throws if it doesn't look like FIX: no 8= up front, a BodyLength that
+    // isn't plain digits or is over MAX_BODY_LENGTH, or no 10= where the
+    // length says the trailer is (the stream is out of sync)
+    inline size_t frame_length(std::string_view data) {
+        constexpr char SOH = '\x01';
+        constexpr size_t TRAILER = 7;      // "10=XXX" + SOH
+        constexpr size_t MAX_HEADER = 32;  // "8=FIX.4.2" SOH "9=NNNNN" SOH, with room to spare
+
+        if (data.size() >= 2 && data.substr(0, 2) != "8=")
+            throw std::runtime_error("fix framing: expected BeginString");
+        auto begin_len = data.find(SOH);
+        if (begin_len == std::string_view::npos) {
+            if (data.size() > MAX_HEADER) throw std::runtime_error("fix framing: BeginString too long");
+            return 0;
+        }
+        if (data.substr(begin_len + 1, 2) != "9=") {
+            if (data.size() < begin_len + 3) return 0;
+            throw std::runtime_error("fix framing: expected BodyLength after BeginString");
+        }
+        auto len_end = data.find(SOH, begin_len + 3);
+        if (len_end == std::string_view::npos) {
+            if (data.size() > MAX_HEADER) throw std::runtime_error("fix framing: BodyLength too long");
+            return 0;
+        }
+
+        auto digits = data.substr(begin_len + 3, len_end - begin_len - 3);
+        if (digits.empty() || digits.size() > 6)
+            throw std::runtime_error("fix framing: bad BodyLength");
+        size_t body_len = 0;
+        for (char c : digits) {
+            if (c < '0' || c > '9') throw std::runtime_error("fix framing: bad BodyLength");
+            body_len = body_len * 10 + static_cast<size_t>(c - '0');
+        }
+        if (body_len > MAX_BODY_LENGTH) throw std::runtime_error("fix framing: BodyLength over limit");
+
+        size_t total = len_end + 1 + body_len + TRAILER;
+        if (data.size() < total) return 0;
+        auto trailer = data.substr(total - TRAILER, TRAILER);
+        if (trailer.substr(0, 3) != "10=" || trailer.back() != SOH)
+            throw std::runtime_error("fix framing: no CheckSum where BodyLength says");
+        return total;
+    }
+
     class FixMessage {
     private:
         std::unordered_map<int, std::string> fields;
         static constexpr char SOH = '\x01';
         static constexpr char PIPE = '|';
 
-        static std::string get_current_time() {
-            auto now = std::chrono::system_clock::now();
-            auto time_t_now = std::chrono::system_clock::to_time_t(now);
-            std::stringstream ss;
-            ss << std::put_time(std::gmtime(&time_t_now), "%Y%m%d-%H:%M:%S.000");
-            return ss.str();
-        }
+        // cached + pre-formatted, see clock.hpp
+        static std::string get_current_time() { return trading::CoarseClock::fix_timestamp(); }
 
         uint8_t calculate_checksum(const std::string& msg) const {
             uint32_t sum = 0;
@@ -157,7 +203,7 @@ namespace fix {
             std::stringstream final_msg;
             final_msg << msg << Tags::CheckSum << "="
                 << std::setfill('0') << std::setw(3)
-                << calculate_checksum(msg) << delimiter;
+                << static_cast<int>(calculate_checksum(msg)) << delimiter;  // uint8_t would print as a char
 
             return final_msg.str();
         }
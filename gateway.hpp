@@ -0,0 +1,202 @@
+#pragma once
+#include "capture.hpp"
+#include "events.hpp"
+#include "fix.hpp"
+#include "runtime.hpp"
+#include "types.hpp"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// inbound side: FIX bytes -> Order. the decoder bits are shared by the
+// loopback gateway and the replay tool's direct path so both go through the
+// exact same code.
+namespace trading::gateway {
+
+    // NewOrderSingle -> Order. ts is the transact time the engine will stamp
+    // its events with (replay passes the capture time so output is repeatable).
+    // ids / symbols that wouldn't fit an EngineEvent are refused here rather
+    // than cut later
+    inline std::shared_ptr<Order> order_from_fix(const fix::FixMessage& msg,
+        std::chrono::system_clock::time_point ts) {
+        auto order = std::make_shared<Order>();
+        order->id = msg.get_string(fix::Tags::ClOrdID);
+        if (order->id.size() > MAX_ORDER_ID_LEN)
+            throw std::runtime_error("gateway: ClOrdID longer than " + std::to_string(MAX_ORDER_ID_LEN));
+        order->symbol = msg.get_string(fix::Tags::Symbol);
+        if (order->symbol.size() > MAX_SYMBOL_LEN)
+            throw std::runtime_error("gateway: Symbol longer than " + std::to_string(MAX_SYMBOL_LEN));
+        order->side = msg.get_char(fix::Tags::Side) == fix::Sides::Buy ? Side::Buy : Side::Sell;
+        order->type = msg.get_char(fix::Tags::OrdType) == fix::OrderTypes::Market ?
+            OrderType::Market : OrderType::Limit;
+        order->price = order->type == OrderType::Limit ? msg.get_price(fix::Tags::Price) : 0;
+        order->qty = msg.get_quantity(fix::Tags::OrderQty);
+        order->timestamp = ts;
+        return order;
+    }
+
+    // cuts a byte stream into whole FIX messages using BodyLength (9=).
+    // 8=...<SOH>9=N<SOH> <N body bytes> 10=XXX<SOH>
+    class FixFramer {
+        std::string buf;
+        size_t pos = 0;
+
+    public:
+        void feed(const char* data, size_t n) {
+            // compact once the consumed prefix is most of the buffer
+            if (pos > 0 && pos * 2 > buf.size()) {
+                buf.erase(0, pos);
+                pos = 0;
+            }
+            buf.append(data, n);
+        }
+
+        // view is valid until the next feed()
+        bool next(std::string_view& msg) {
+            size_t total = fix::frame_length(std::string_view(buf).substr(pos));
+            if (!total) return false;
+            msg = std::string_view(buf.data() + pos, total);
+            pos += total;
+            return true;
+        }
+
+        size_t buffered() const { return buf.size() - pos; }
+    };
+
+    // tcp gateway on 127.0.0.1 for driving the engine through a real socket.
+    // the constructor grabs a free port, connect_client() gives back the client
+    // end, start() runs the reading side as the gateway runtime thread and
+    // hands every framed message to on_message (on that thread). with
+    // capture_to() set, every framed message also goes into a capture file
+    // stamped with the wall clock time its bytes came off the socket.
+    class LoopbackGateway {
+        struct Shared {
+            int fd = -1;
+            FixFramer framer;
+            std::function<void(std::string_view)> on_message;
+            capture::CaptureWriter* tap = nullptr;  // only touched on the gateway thread once started
+            std::atomic<bool> done{false};
+            std::atomic<bool> failed{false};
+            std::atomic<uint64_t> messages{0};
+
+            ~Shared() { if (fd >= 0) ::close(fd); }
+        };
+
+        int listen_fd = -1;
+        uint16_t port = 0;
+        std::shared_ptr<Shared> shared = std::make_shared<Shared>();
+
+        static void no_delay(int fd) {
+            int flag = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));  // like a chad
+        }
+
+    public:
+        LoopbackGateway() {
+            listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (listen_fd < 0) throw std::runtime_error("gateway: socket failed");
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = 0;
+            socklen_t len = sizeof(addr);
+            if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+                ::listen(listen_fd, 1) < 0 ||
+                getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &len) < 0) {
+                ::close(listen_fd);
+                throw std::runtime_error("gateway: can't listen on loopback");
+            }
+            port = ntohs(addr.sin_port);
+        }
+
+        ~LoopbackGateway() { if (listen_fd >= 0) ::close(listen_fd); }
+
+        LoopbackGateway(const LoopbackGateway&) = delete;
+        LoopbackGateway& operator=(const LoopbackGateway&) = delete;
+
+        uint16_t get_port() const { return port; }
+
+        // blocking client socket already accepted on our side. caller closes it
+        // when done sending, which is how the gateway knows the stream ended
+        int connect_client() {
+            int client = socket(AF_INET, SOCK_STREAM, 0);
+            if (client < 0) throw std::runtime_error("gateway: socket failed");
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons(port);
+            if (connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+                ::close(client);
+                throw std::runtime_error("gateway: connect failed");
+            }
+            no_delay(client);
+
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd < 0) {
+                ::close(client);
+                throw std::runtime_error("gateway: accept failed");
+            }
+            no_delay(fd);
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            shared->fd = fd;
+            return client;
+        }
+
+        // optional, before start(). the writer has to outlive the gateway thread
+        void capture_to(capture::CaptureWriter& writer) { shared->tap = &writer; }
+
+        void start(runtime::Runtime& rt, std::function<void(std::string_view)> on_message) {
+            if (shared->fd < 0) throw std::runtime_error("gateway: no client connected");
+            shared->on_message = std::move(on_message);
+            rt.spawn(runtime::Role::Gateway, [s = shared](runtime::WorkerContext&) {
+                return runtime::PollFn([s]() {
+                    if (s->done.load(std::memory_order_relaxed)) return false;
+                    char buf[64 * 1024];
+                    ssize_t n = recv(s->fd, buf, sizeof(buf), 0);
+                    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return false;
+
+                    // a broken socket or stream we can't frame ends the session
+                    // (no exceptions out of a runtime thread)
+                    bool ok = n >= 0;
+                    if (n > 0) {
+                        int64_t rx_ns = s->tap ? std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::system_clock::now().time_since_epoch()).count() : 0;
+                        s->framer.feed(buf, static_cast<size_t>(n));
+                        try {
+                            std::string_view msg;
+                            uint64_t count = 0;
+                            while (s->framer.next(msg)) {
+                                if (s->tap) s->tap->write(rx_ns, msg);
+                                s->on_message(msg);
+                                ++count;
+                            }
+                            s->messages.fetch_add(count, std::memory_order_relaxed);
+                        } catch (const std::exception&) {
+                            ok = false;
+                        }
+                    }
+                    if (!ok) s->failed.store(true, std::memory_order_relaxed);
+                    if (n <= 0 || !ok) s->done.store(true, std::memory_order_release);  // hung up / broken
+                    return true;
+                });
+            });
+        }
+
+        // peer closed and every complete message was handed over
+        bool finished() const { return shared->done.load(std::memory_order_acquire); }
+        bool failed() const { return shared->failed.load(std::memory_order_relaxed); }
+        uint64_t messages() const { return shared->messages.load(std::memory_order_relaxed); }
+    };
+
+}  // namespace trading::gateway
@@ -1,162 +1,34 @@
-#include "types.hpp"
+#include "engine.hpp"
 #include "fix.hpp"
-#include <map>
-#include <list>
-#include <memory>
-#include <sstream>
-#include <iomanip>
-
-namespace trading {
-
-    // fr fr no cap logging utility
-    class Logger {
-        static inline std::string get_time() {
-            auto now = std::chrono::system_clock::now();
-            auto tt = std::chrono::system_clock::to_time_t(now);
-            std::stringstream ss;
-            ss << std::put_time(std::localtime(&tt), "%H:%M:%S");
-            return ss.str();
-        }
-
-    public:
-        template<typename... Args>
-        static void log(const Args&... args) {
-            std::stringstream ss;
-            ss << "[" << get_time() << "] ";
-            (ss << ... << args);
-            std::cout << ss.str() << std::endl;
-        }
-    };
-
-    template<typename PriceComparator>
-    class OrderBook {
-        using OrderPtr = std::shared_ptr<Order>;
-        using OrderList = std::list<OrderPtr>;
-        using PriceLevel = std::pair<Price, OrderList>;
-        using OrderMap = std::map<Price, OrderList, PriceComparator>;
-
-        OrderMap orders;
-        std::string symbol;
-
-    public:
-        OrderBook(std::string sym) : symbol(std::move(sym)) {}
-
-        void add(const OrderPtr& order) {
-            orders[order->price].push_back(order);
-            Logger::log("added order ", order->id, " @ ", order->price / 10000.0);
-        }
-
-        void remove(const OrderPtr& order) {
-            auto& list = orders[order->price];
-            list.remove(order);
-            if (list.empty()) orders.erase(order->price);
-            Logger::log("removed order ", order->id);
-        }
-
-        OrderPtr best() const {
-            if (orders.empty()) return nullptr;
-            const auto& best_list = orders.begin()->second;
-            return best_list.empty() ? nullptr : best_list.front();
-        }
-
-        // no cap this is useful for debugging
-        void print_state() const {
-            for (const auto& [price, orders] : this->orders) {
-                std::stringstream ss;
-                ss << std::fixed << std::setprecision(2) << price / 10000.0 << ": ";
-                for (const auto& order : orders) {
-                    ss << order->id << "(" << order->remaining() << ") ";
-                }
-                Logger::log(ss.str());
-            }
-        }
-    };
-
-    class MatchingEngine {
-        // min heap for asks (selling), max heap for bids (buying)
-        using AskBook = OrderBook<std::less<Price>>;
-        using BidBook = OrderBook<std::greater<Price>>;
-        AskBook asks;
-        BidBook bids;
-
-        void match(std::shared_ptr<Order>& incoming) {
-            if (incoming->side == Side::Buy) {
-                match_order(incoming, asks, bids);
-            } else {
-                match_order(incoming, bids, asks);
-            }
-        }
-
-        template<typename ContraBook, typename SameBook>
-        void match_order(std::shared_ptr<Order>& incoming,
-            ContraBook& contra_book,
-            SameBook& same_book) {
-
-            Logger::log(
-                "matching ", incoming->id, " ",
-                incoming->side == Side::Buy ? "buy" : "sell", " ",
-                incoming->qty, " @ ",
-                incoming->type == OrderType::Market ? "MKT" :
-                std::to_string(incoming->price / 10000.0)
-            );
-
-            while (!incoming->is_filled()) {
-                auto resting = contra_book.best();
-                if (!resting || !price_matches(incoming, resting)) break;
-
-                auto match_qty = std::min(incoming->remaining(), resting->remaining());
-                execute_match(incoming, resting, match_qty);
-
-                if (resting->is_filled())
-                    contra_book.remove(resting);
-            }
-
-            if (!incoming->is_filled() && incoming->type == OrderType::Limit)
-                same_book.add(incoming);
-
-
-            Logger::log("post-match state:");
-            Logger::log("asks:");
-            asks.print_state();
-            Logger::log("bids:");
-            bids.print_state();
-        }
-
-        bool price_matches(const std::shared_ptr<Order>& incoming,
-            const std::shared_ptr<Order>& resting) {
-            if (incoming->type == OrderType::Market) return true;
-            return incoming->side == Side::Buy ?
-                incoming->price >= resting->price :
-                incoming->price <= resting->price;
-        }
-
-        void execute_match(std::shared_ptr<Order>& incoming,
-            std::shared_ptr<Order>& resting,
-            Quantity qty) {
-            incoming->filled += qty;
-            resting->filled += qty;
-            Logger::log(
-                "match: ", incoming->id, " vs ", resting->id,
-                " for ", qty, " @ ", resting->price / 10000.0
-            );
-        }
-
-    public:
-        MatchingEngine(std::string symbol) : asks(symbol), bids(symbol) {}
-
-        void handle(std::shared_ptr<Order> order) {
-            match(order);
-        }
-    };
-}  // namespace trading
+#include "runtime.hpp"
+#include "dropcopy.hpp"
 
 
 // fr fr test harness no cap
-int main() {
+int main(int argc, char** argv) {
     using namespace trading;
 
+    // usage: orderbook [RUNTIME_CONF|-] [DROPCOPY_FILE]
+    // optional thread layout, see runtime.hpp / runtime.conf
+    bool has_cfg = argc > 1 && std::string(argv[1]) != "-";
+    auto cfg = has_cfg ? runtime::RuntimeConfig::load(argv[1]) : runtime::RuntimeConfig{};
+    runtime::Runtime rt(cfg);
+
+    // every other thread first: they'd inherit the matcher pin otherwise
+    CoarseClock::start();
     auto me = std::make_unique<MatchingEngine>("AAPL");
 
+    // optional drop copy / audit file, read it back with dropcopy_cat
+    std::unique_ptr<dropcopy::DropCopy> drop_copy;
+    if (argc > 2) {
+        drop_copy = std::make_unique<dropcopy::DropCopy>(rt, argv[2]);
+        me->set_listener(drop_copy.get());
+    }
+
+    auto matcher = rt.adopt(runtime::Role::Matcher);
+    if (!rt.pinned(runtime::Role::Matcher))
+        Logger::log("couldn't pin matcher to cpu ", cfg[runtime::Role::Matcher].cpu);
+
     // create some limit orders innit
     auto make_order = [](std::string id, Side side, OrderType type,
         Price price, Quantity qty) {
@@ -167,7 +39,7 @@ int main() {
         order->type = type;
         order->price = price;
         order->qty = qty;
-        order->timestamp = std::chrono::system_clock::now();
+        order->timestamp = CoarseClock::now();
         return order;
     };
 
@@ -182,5 +54,28 @@ int main() {
     // send in a fat market order, watch it match
     me->handle(make_order("buymarket", Side::Buy, OrderType::Market, 0, 150));
 
+    // and change our mind about the bid
+    auto buy2 = make_order("buy2", Side::Buy, OrderType::Limit, fix::to_fix_price(98), 50);
+    me->handle(buy2);
+    me->cancel(buy2);
+    matcher.busy();
+
+    // closing auction: orders pile up crossed, then print at one price
+    me->start_auction();
+    me->handle(make_order("closebuy1", Side::Buy, OrderType::Limit, fix::to_fix_price(102), 150));
+    me->handle(make_order("closesell1", Side::Sell, OrderType::Limit, fix::to_fix_price(98), 120));
+    me->handle(make_order("closebuymkt", Side::Buy, OrderType::Market, 0, 30));
+    auto ind = me->indicative();
+    Logger::log("indicative ", ind.volume, " @ ", ind.price / 10000.0);
+    me->uncross(fix::to_fix_price(100));
+    matcher.busy();
+
+    if (drop_copy) {
+        drop_copy->close();
+        if (drop_copy->events_truncated())
+            Logger::log("drop copy: ", drop_copy->events_truncated(), " events with truncated ids / symbols");
+    }
+    if (has_cfg) rt.report(std::cout);
+    CoarseClock::stop();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,499 @@
+#include "engine.hpp"
+#include "capture.hpp"
+#include "gateway.hpp"
+#include "runtime.hpp"
+#include "fix.hpp"
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// order flow capture + deterministic replay, for perf regression runs
+//
+//   replay gen OUT.cap N [--symbols AAPL,MSFT] [--rate MSGS_PER_SEC] [--seed S]
+//       synthetic capture, for when there's no production day lying around
+//
+//   replay run IN.cap [--via handle|loopback] [--speed X] [--runtime CONF]
+//                     [--events OUT.bin] [--report OUT.txt] [--baseline OLD.txt]
+//                     [--record OUT.cap] [--verbose]
+//       --via handle    decode + MatchingEngine::handle on this thread (default)
+//       --via loopback  push the raw bytes through a tcp 127.0.0.1 gateway thread
+//       --speed 0       as fast as possible (default), 1 = original pacing, 2 = twice as fast
+//       --events        dump every engine event in canonical form, diff two builds with cmp
+//       --baseline      compare against an older --report: event digest must match
+//                       (exit 2 if not). throughput / latency deltas only get printed
+//                       when --via and --speed are the same as the baseline's
+//       --record        loopback only: the gateway's capture tap writes what it framed
+//                       (receive time stamped) to a new capture
+//
+// order timestamps come from the capture, not the wall clock, so the event
+// stream is a pure function of the capture and the engine code.
+//
+// latency is per message: decode + match for handle, send -> matched for
+// loopback. loopback at --speed 0 blasts the whole capture into the socket,
+// so its numbers are mostly how long a message sat in the send backlog.
+// only paced loopback runs (--speed > 0, slow enough to keep up) say
+// anything about the gateway path.
+namespace {
+
+    using namespace trading;
+    using Clock = std::chrono::steady_clock;
+
+    int64_t steady_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    // log linear, 16 sub buckets per power of two (~6% resolution). fixed size
+    // so a billion message day doesn't need a billion samples in memory
+    class LatencyHistogram {
+        static constexpr int SUB_BITS = 4;
+        static constexpr int SUB = 1 << SUB_BITS;
+        std::array<uint64_t, SUB + (64 - SUB_BITS) * SUB> buckets{};
+        uint64_t total = 0;
+        uint64_t max_ns = 0;
+
+        static size_t index(uint64_t v) {
+            if (v < SUB) return v;
+            int msb = 63 - __builtin_clzll(v);
+            return SUB + (msb - SUB_BITS) * SUB + ((v >> (msb - SUB_BITS)) & (SUB - 1));
+        }
+
+        static uint64_t lower_bound(size_t i) {
+            if (i < SUB) return i;
+            size_t msb = (i - SUB) / SUB + SUB_BITS;
+            return (uint64_t(1) << msb) | (uint64_t((i - SUB) % SUB) << (msb - SUB_BITS));
+        }
+
+    public:
+        void add(int64_t ns) {
+            auto v = static_cast<uint64_t>(std::max<int64_t>(ns, 0));
+            ++buckets[index(v)];
+            ++total;
+            max_ns = std::max(max_ns, v);
+        }
+
+        uint64_t count() const { return total; }
+        uint64_t max() const { return max_ns; }
+
+        uint64_t percentile(double p) const {
+            if (!total) return 0;
+            auto want = static_cast<uint64_t>(std::ceil(p / 100.0 * total));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < buckets.size(); ++i) {
+                seen += buckets[i];
+                if (seen >= want && buckets[i]) return lower_bound(i);
+            }
+            return max_ns;
+        }
+    };
+
+    // fnv-1a over a canonical little endian encoding of every event, and
+    // optionally the same bytes to a file
+    class EventDigest : public EventListener {
+        uint64_t hash = 1469598103934665603ull;
+        uint64_t count = 0;
+        std::FILE* out = nullptr;
+        std::vector<uint8_t> buf;
+
+        void put_bytes(const void* p, size_t n) {
+            auto* b = static_cast<const uint8_t*>(p);
+            buf.insert(buf.end(), b, b + n);
+        }
+
+        void put_i64(int64_t v) {
+            uint8_t le[8];
+            for (int i = 0; i < 8; ++i) le[i] = static_cast<uint8_t>(static_cast<uint64_t>(v) >> (8 * i));
+            put_bytes(le, 8);
+        }
+
+        void put_str(std::string_view s) {
+            buf.push_back(static_cast<uint8_t>(s.size()));
+            put_bytes(s.data(), s.size());
+        }
+
+    public:
+        explicit EventDigest(const std::string& dump_path = "") {
+            if (dump_path.empty()) return;
+            out = std::fopen(dump_path.c_str(), "wb");
+            if (!out) throw std::runtime_error("can't open " + dump_path);
+        }
+
+        ~EventDigest() override { if (out) std::fclose(out); }
+
+        void on_event(const EngineEvent& ev) override {
+            buf.clear();
+            buf.push_back(static_cast<uint8_t>(ev.type));
+            buf.push_back(static_cast<uint8_t>(ev.side));
+            buf.push_back(static_cast<uint8_t>(ev.order_type));
+            put_i64(ev.ts_us);
+            put_i64(ev.price);
+            put_i64(ev.qty);
+            put_i64(ev.leaves);
+            put_str(ev.symbol.view());
+            put_str(ev.order_id.view());
+            put_str(ev.contra_id.view());
+
+            for (auto b : buf) {
+                hash ^= b;
+                hash *= 1099511628211ull;
+            }
+            ++count;
+            if (out) std::fwrite(buf.data(), 1, buf.size(), out);
+        }
+
+        uint64_t digest() const { return hash; }
+        uint64_t events() const { return count; }
+    };
+
+    // one book per symbol, made on first sight
+    class Engines {
+        std::unordered_map<std::string, std::unique_ptr<MatchingEngine>> books;
+        EventListener* listener;
+
+    public:
+        explicit Engines(EventListener* l) : listener(l) {}
+
+        void handle(std::shared_ptr<Order> order) {
+            auto& me = books[order->symbol];
+            if (!me) {
+                me = std::make_unique<MatchingEngine>(order->symbol);
+                me->set_listener(listener);
+            }
+            me->handle(std::move(order));
+        }
+    };
+
+    struct Counters {
+        uint64_t messages = 0;
+        uint64_t orders = 0;
+        uint64_t skipped = 0;   // parsed fine, not a NewOrderSingle
+        uint64_t rejected = 0;  // didn't parse / missing fields
+    };
+
+    // decode one raw message and feed it in, same path for both modes
+    void process(std::string_view raw, int64_t capture_ts_ns, Engines& engines, Counters& c) {
+        ++c.messages;
+        try {
+            auto msg = fix::FixMessage::parse(std::string(raw));
+            if (!msg.has_field(fix::Tags::MsgType) || msg.get_char(fix::Tags::MsgType) != fix::MsgTypes::NewOrderSingle) {
+                ++c.skipped;
+                return;
+            }
+            auto ts = std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    std::chrono::nanoseconds(capture_ts_ns)));
+            engines.handle(gateway::order_from_fix(msg, ts));
+            ++c.orders;
+        } catch (const std::exception&) {
+            ++c.rejected;
+        }
+    }
+
+    // spin-ish until the capture's relative time (scaled) has passed
+    class Pacer {
+        double speed;
+        int64_t first_capture = -1;
+        int64_t start = 0;
+
+    public:
+        explicit Pacer(double s) : speed(s) {}
+
+        void wait(int64_t capture_ts_ns) {
+            if (speed <= 0) return;
+            if (first_capture < 0) {
+                first_capture = capture_ts_ns;
+                start = steady_ns();
+                return;
+            }
+            auto target = start + static_cast<int64_t>((capture_ts_ns - first_capture) / speed);
+            while (true) {
+                auto left = target - steady_ns();
+                if (left <= 0) return;
+                if (left > 200000) std::this_thread::sleep_for(std::chrono::nanoseconds(left - 100000));
+                else runtime::cpu_relax();
+            }
+        }
+    };
+
+    using Report = std::map<std::string, std::string>;
+
+    Report load_report(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) throw std::runtime_error("can't open baseline " + path);
+        Report r;
+        std::string line;
+        while (std::getline(in, line)) {
+            auto eq = line.find('=');
+            if (eq != std::string::npos) r[line.substr(0, eq)] = line.substr(eq + 1);
+        }
+        return r;
+    }
+
+    struct RunOptions {
+        std::string capture;
+        std::string via = "handle";
+        double speed = 0;
+        std::string runtime_conf;
+        std::string events_path;
+        std::string report_path;
+        std::string baseline_path;
+        std::string record_path;
+        bool verbose = false;
+    };
+
+    int run(const RunOptions& opt) {
+        if (opt.via != "handle" && opt.via != "loopback")
+            throw std::runtime_error("--via must be handle or loopback");
+        if (!opt.record_path.empty() && opt.via != "loopback")
+            throw std::runtime_error("--record needs --via loopback");
+
+        Logger::enabled = opt.verbose;
+        CoarseClock::Session clock;
+
+        capture::CaptureReader reader(opt.capture);
+        EventDigest digest(opt.events_path);
+        Engines engines(&digest);
+        Counters counters;
+        LatencyHistogram hist;
+        Pacer pacer(opt.speed);
+
+        auto cfg = opt.runtime_conf.empty() ? runtime::RuntimeConfig{} : runtime::RuntimeConfig::load(opt.runtime_conf);
+        runtime::Runtime rt(cfg);
+
+        int64_t t_start = steady_ns();
+
+        if (opt.via == "handle") {
+            auto matcher = rt.adopt(runtime::Role::Matcher);
+            for (auto& rec : reader) {
+                pacer.wait(rec.ts_ns);
+                matcher.waited();
+                auto t0 = steady_ns();
+                process(rec.data, rec.ts_ns, engines, counters);
+                hist.add(steady_ns() - t0);
+                matcher.busy();
+            }
+        } else if (opt.via == "loopback") {
+            // the gateway thread only sees bytes, so send time + capture time
+            // ride along in a ring indexed by message number
+            struct Slot {
+                std::atomic<int64_t> sent_ns{0};
+                std::atomic<int64_t> capture_ns{0};
+            };
+            constexpr size_t RING = 1 << 20;
+            std::vector<Slot> slots(RING);
+            std::atomic<uint64_t> processed{0};
+            std::unique_ptr<capture::CaptureWriter> record;
+            if (!opt.record_path.empty()) record = std::make_unique<capture::CaptureWriter>(opt.record_path);
+
+            gateway::LoopbackGateway gw;
+            int client = gw.connect_client();
+            if (record) gw.capture_to(*record);
+
+            // the gateway thread points into this block (slots, processed,
+            // record), so it has to be gone before they are, throw or not
+            struct StopRuntime {
+                runtime::Runtime& rt;
+                ~StopRuntime() { rt.stop(); }
+            } stop_gateway{rt};
+
+            gw.start(rt, [&](std::string_view raw) {
+                auto seq = processed.load(std::memory_order_relaxed);
+                auto& slot = slots[seq & (RING - 1)];
+                process(raw, slot.capture_ns.load(std::memory_order_acquire), engines, counters);
+                hist.add(steady_ns() - slot.sent_ns.load(std::memory_order_relaxed));
+                processed.store(seq + 1, std::memory_order_release);
+            });
+
+            uint64_t seq = 0;
+            for (auto& rec : reader) {
+                pacer.wait(rec.ts_ns);
+                while (seq - processed.load(std::memory_order_acquire) >= RING) std::this_thread::yield();
+                auto& slot = slots[seq & (RING - 1)];
+                slot.sent_ns.store(steady_ns(), std::memory_order_relaxed);
+                slot.capture_ns.store(rec.ts_ns, std::memory_order_release);
+                ++seq;
+
+                size_t off = 0;
+                while (off < rec.data.size()) {
+                    auto n = send(client, rec.data.data() + off, rec.data.size() - off, MSG_NOSIGNAL);
+                    if (n <= 0) {
+                        if (n < 0 && errno == EINTR) continue;
+                        ::close(client);
+                        throw std::runtime_error("loopback send failed");
+                    }
+                    off += static_cast<size_t>(n);
+                }
+            }
+            ::close(client);
+            while (!gw.finished()) std::this_thread::yield();
+            if (gw.failed()) throw std::runtime_error("loopback gateway couldn't frame the stream");
+        }
+
+        int64_t elapsed_ns = steady_ns() - t_start;
+
+        double secs = elapsed_ns / 1e9;
+        char digest_hex[17];
+        std::snprintf(digest_hex, sizeof(digest_hex), "%016llx", static_cast<unsigned long long>(digest.digest()));
+
+        Report report;
+        report["capture"] = opt.capture;
+        report["via"] = opt.via;
+        report["speed"] = std::to_string(opt.speed);
+        report["messages"] = std::to_string(counters.messages);
+        report["orders"] = std::to_string(counters.orders);
+        report["skipped"] = std::to_string(counters.skipped);
+        report["rejected"] = std::to_string(counters.rejected);
+        report["events"] = std::to_string(digest.events());
+        report["digest"] = digest_hex;
+        report["elapsed_s"] = std::to_string(secs);
+        report["msgs_per_s"] = std::to_string(secs > 0 ? counters.messages / secs : 0);
+        report["p50_ns"] = std::to_string(hist.percentile(50));
+        report["p99_ns"] = std::to_string(hist.percentile(99));
+        report["p999_ns"] = std::to_string(hist.percentile(99.9));
+        report["max_ns"] = std::to_string(hist.max());
+
+        for (auto& [k, v] : report) std::cout << k << "=" << v << "\n";
+        if (opt.verbose) rt.report(std::cout);
+
+        if (!opt.report_path.empty()) {
+            std::ofstream out(opt.report_path);
+            for (auto& [k, v] : report) out << k << "=" << v << "\n";
+        }
+
+        if (opt.baseline_path.empty()) return 0;
+
+        auto base = load_report(opt.baseline_path);
+        bool same = base["digest"] == report["digest"] && base["events"] == report["events"];
+        std::cout << "\nvs baseline " << opt.baseline_path << ":\n"
+            << "  events " << (same ? "IDENTICAL" : "DIFFERENT")
+            << " (" << base["digest"] << " -> " << report["digest"] << ")\n";
+        // timing from a different mode or pace isn't comparable, only the events are
+        if (base["via"] != report["via"] || base["speed"] != report["speed"]) {
+            std::cout << "  timing not compared: baseline is via=" << base["via"] << " speed=" << base["speed"]
+                << ", this run via=" << report["via"] << " speed=" << report["speed"] << "\n";
+            return same ? 0 : 2;
+        }
+        if (opt.via == "loopback" && opt.speed <= 0)
+            std::cout << "  note: unpaced loopback, latency is mostly send backlog\n";
+        // positive = better for throughput, negative = better for latency
+        for (auto key : { "msgs_per_s", "p50_ns", "p99_ns", "p999_ns", "max_ns" }) {
+            if (!base.count(key)) continue;
+            double was = std::stod(base[key]), now = std::stod(report[key]);
+            std::cout << "  " << key << " " << base[key] << " -> " << report[key];
+            if (was != 0) std::printf(" (%+.1f%%)", (now - was) / was * 100.0);
+            std::cout << "\n";
+        }
+        return same ? 0 : 2;
+    }
+
+    int gen(const std::string& path, uint64_t n, const std::vector<std::string>& symbols,
+        double rate, uint64_t seed) {
+        CoarseClock::Session clock;
+        capture::CaptureWriter out(path);
+        std::mt19937_64 rng(seed);
+        std::exponential_distribution<double> gap(rate);
+        std::uniform_int_distribution<int> ticks(-20, 20), lots(1, 10), pct(0, 99);
+
+        auto ts = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        std::unordered_map<std::string, uint64_t> next_id;
+
+        for (uint64_t i = 0; i < n; ++i) {
+            const auto& sym = symbols[rng() % symbols.size()];
+            char side = (rng() & 1) ? fix::Sides::Buy : fix::Sides::Sell;
+            bool market = pct(rng) < 5;
+            // bids lean low and asks lean high so the book builds up, with
+            // enough overlap to keep the matcher busy
+            int skew = side == fix::Sides::Buy ? -5 : 5;
+            fix::Price px = fix::to_fix_price(100) + (ticks(rng) + skew) * 100;
+
+            auto msg = fix::FixMessageFactory::create_new_order_single(
+                sym + "-" + std::to_string(next_id[sym]++), sym, side, px, lots(rng) * 100,
+                market ? fix::OrderTypes::Market : fix::OrderTypes::Limit);
+
+            ts += static_cast<int64_t>(gap(rng) * 1e9);
+            out.write(ts, msg.serialize());
+        }
+        out.close();
+        std::cout << "wrote " << n << " messages to " << path << "\n";
+        return 0;
+    }
+
+    std::vector<std::string> split(const std::string& s, char sep) {
+        std::vector<std::string> out;
+        std::stringstream ss(s);
+        std::string part;
+        while (std::getline(ss, part, sep))
+            if (!part.empty()) out.push_back(part);
+        return out;
+    }
+
+    int usage(const char* argv0) {
+        std::cerr << "usage:\n"
+            << "  " << argv0 << " gen OUT.cap N [--symbols A,B] [--rate MSGS_PER_SEC] [--seed S]\n"
+            << "  " << argv0 << " run IN.cap [--via handle|loopback] [--speed X] [--runtime CONF]\n"
+            << "       [--events OUT.bin] [--report OUT.txt] [--baseline OLD.txt]\n"
+            << "       [--record OUT.cap] [--verbose]\n";
+        return 1;
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) return usage(argv[0]);
+    std::string mode = argv[1];
+
+    try {
+        std::map<std::string, std::string> flags;
+        std::vector<std::string> positional;
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--verbose") flags[arg] = "1";
+            else if (arg.rfind("--", 0) == 0) {
+                if (i + 1 >= argc) throw std::runtime_error("missing value for " + arg);
+                flags[arg] = argv[++i];
+            } else positional.push_back(arg);
+        }
+        auto flag = [&](const std::string& k, const std::string& def) {
+            auto it = flags.find(k);
+            return it == flags.end() ? def : it->second;
+        };
+
+        if (mode == "gen") {
+            if (positional.size() != 2) return usage(argv[0]);
+            return gen(positional[0], std::stoull(positional[1]),
+                split(flag("--symbols", "AAPL"), ','),
+                std::stod(flag("--rate", "100000")),
+                std::stoull(flag("--seed", "42")));
+        }
+        if (mode == "run") {
+            if (positional.size() != 1) return usage(argv[0]);
+            RunOptions opt;
+            opt.capture = positional[0];
+            opt.via = flag("--via", "handle");
+            opt.speed = std::stod(flag("--speed", "0"));
+            opt.runtime_conf = flag("--runtime", "");
+            opt.events_path = flag("--events", "");
+            opt.report_path = flag("--report", "");
+            opt.baseline_path = flag("--baseline", "");
+            opt.record_path = flag("--record", "");
+            opt.verbose = flags.count("--verbose") > 0;
+            return run(opt);
+        }
+        return usage(argv[0]);
+    } catch (const std::exception& e) {
+        std::cerr << "bruh: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,503 @@
+#pragma once
+#include "spsc_queue.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// engine process runtime: which thread runs on which core, where its memory
+// lives and what it does when there's nothing to do. the python dog server
+// does the pin-to-core-0 thing by hand, this is the c++ version of that.
+namespace trading::runtime {
+
+    // gateway and dropcopy are spawned workers, the matcher is whoever calls
+    // adopt(). decoder, logger and publisher only have config slots so far,
+    // nothing spawns them (Logger::log still writes on the calling thread)
+    enum class Role { Gateway, Decoder, Matcher, Logger, Publisher, DropCopy };
+    constexpr size_t ROLE_COUNT = 6;
+
+    inline const char* role_name(Role r) {
+        switch (r) {
+            case Role::Gateway: return "gateway";
+            case Role::Decoder: return "decoder";
+            case Role::Matcher: return "matcher";
+            case Role::Logger: return "logger";
+            case Role::Publisher: return "publisher";
+            case Role::DropCopy: return "dropcopy";
+        }
+        return "?";
+    }
+
+    inline Role role_from_name(const std::string& name) {
+        for (size_t i = 0; i < ROLE_COUNT; ++i)
+            if (name == role_name(static_cast<Role>(i))) return static_cast<Role>(i);
+        throw std::runtime_error("unknown thread role: " + name);
+    }
+
+    enum class IdleMode {
+        BusySpin,  // burn the core, lowest wakeup latency
+        Adaptive   // spin, then yield, then back off into short sleeps
+    };
+
+    struct ThreadConfig {
+        int cpu = -1;                    // -1 = let the scheduler decide
+        IdleMode idle = IdleMode::Adaptive;
+        size_t arena_bytes = 16 << 20;   // node local memory for queues / pools
+    };
+
+    // config is one line per role, '#' comments, e.g.
+    //   matcher   = 2  busy   64M
+    //   logger    = 5  adaptive
+    //   gateway   = -1
+    // cpu is required, idle mode and arena size are optional
+    struct RuntimeConfig {
+        std::array<ThreadConfig, ROLE_COUNT> threads{};
+
+        ThreadConfig& operator[](Role r) { return threads[static_cast<size_t>(r)]; }
+        const ThreadConfig& operator[](Role r) const { return threads[static_cast<size_t>(r)]; }
+
+        // digits with an optional single k / m / g suffix, nothing after it
+        static size_t parse_size(const std::string& s) {
+            if (s.empty() || !std::isdigit(static_cast<unsigned char>(s[0])))
+                throw std::runtime_error("bad size: " + s);
+            size_t pos = 0;
+            size_t n = std::stoull(s, &pos);
+            if (pos == s.size()) return n;
+            if (pos + 1 == s.size()) {
+                switch (s[pos]) {
+                    case 'k': case 'K': return n << 10;
+                    case 'm': case 'M': return n << 20;
+                    case 'g': case 'G': return n << 30;
+                }
+            }
+            throw std::runtime_error("bad size: " + s);
+        }
+
+        static int parse_cpu(const std::string& s) {
+            size_t pos = 0;
+            int cpu = -2;
+            try {
+                cpu = std::stoi(s, &pos);
+            } catch (const std::exception&) {
+                pos = 0;
+            }
+            if (pos != s.size() || cpu < -1) throw std::runtime_error("bad cpu: " + s);
+            return cpu;
+        }
+
+        static RuntimeConfig parse(const std::string& text) {
+            RuntimeConfig cfg;
+            std::stringstream lines(text);
+            std::string line;
+            int line_no = 0;
+            while (std::getline(lines, line)) {
+                ++line_no;
+                auto hash = line.find('#');
+                if (hash != std::string::npos) line.erase(hash);
+                if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+                // every error names the line it came from
+                try {
+                    auto eq = line.find('=');
+                    if (eq == std::string::npos) throw std::runtime_error("expected role = cpu");
+
+                    std::stringstream lhs(line.substr(0, eq)), rhs(line.substr(eq + 1));
+                    std::string name, cpu, idle, arena, extra;
+                    lhs >> name >> extra;
+                    if (!extra.empty()) throw std::runtime_error("junk before '=': " + extra);
+                    rhs >> cpu >> idle >> arena >> extra;
+                    if (!extra.empty()) throw std::runtime_error("junk after arena size: " + extra);
+                    if (cpu.empty()) throw std::runtime_error("missing cpu for " + name);
+
+                    auto& t = cfg[role_from_name(name)];
+                    t.cpu = parse_cpu(cpu);
+                    if (idle == "busy") t.idle = IdleMode::BusySpin;
+                    else if (idle == "adaptive" || idle.empty()) t.idle = IdleMode::Adaptive;
+                    else throw std::runtime_error("bad idle mode: " + idle);
+                    if (!arena.empty()) t.arena_bytes = parse_size(arena);
+                } catch (const std::exception& e) {
+                    throw std::runtime_error("runtime config line " + std::to_string(line_no) +
+                        " (" + line + "): " + e.what());
+                }
+            }
+            return cfg;
+        }
+
+        static RuntimeConfig load(const std::string& path) {
+            std::ifstream in(path);
+            if (!in) throw std::runtime_error("can't open runtime config: " + path);
+            std::stringstream ss;
+            ss << in.rdbuf();
+            return parse(ss.str());
+        }
+    };
+
+    // -1 if the box has no numa info (containers, single node, whatever)
+    inline int numa_node_of_cpu(int cpu) {
+        if (cpu < 0) return -1;
+        for (int node = 0; node < 64; ++node) {
+            std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                "/node" + std::to_string(node);
+            if (access(path.c_str(), F_OK) == 0) return node;
+        }
+        return -1;
+    }
+
+    // cpu -1 leaves the mask alone, see Runtime::place for what unpinned means
+    inline bool pin_current_thread(int cpu) {
+        if (cpu < 0) return true;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+    inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    // bump allocator over an mmap'd region. we ask the kernel to prefer the
+    // given node (raw mbind so we don't drag in libnuma) and then touch every
+    // page from the owning thread, so first-touch puts it local even when
+    // mbind isn't allowed. nothing is ever freed individually.
+    class NodeArena {
+        char* base = nullptr;
+        size_t size = 0;
+        size_t used = 0;
+        int node = -1;
+
+        static constexpr int MPOL_PREFERRED_ = 1;
+
+    public:
+        NodeArena(size_t bytes, int numa_node) : size(bytes), node(numa_node) {
+            if (size == 0) return;
+            void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) throw std::runtime_error("arena mmap failed");
+            base = static_cast<char*>(p);
+
+#ifdef SYS_mbind
+            if (node >= 0 && node < 64) {
+                unsigned long mask = 1UL << node;
+                syscall(SYS_mbind, base, size, MPOL_PREFERRED_, &mask, 64, 0);
+            }
+#endif
+            std::memset(base, 0, size);  // first touch, and no page faults later
+        }
+
+        ~NodeArena() { if (base) munmap(base, size); }
+
+        NodeArena(const NodeArena&) = delete;
+        NodeArena& operator=(const NodeArena&) = delete;
+
+        void* allocate(size_t bytes, size_t align = CACHE_LINE) {
+            size_t start = (used + align - 1) & ~(align - 1);
+            if (start + bytes > size) throw std::runtime_error("node arena exhausted");
+            used = start + bytes;
+            return base + start;
+        }
+
+        template<typename T, typename... Args>
+        T* make(Args&&... args) {
+            return new (allocate(sizeof(T), alignof(T) > CACHE_LINE ? alignof(T) : CACHE_LINE))
+                T(std::forward<Args>(args)...);
+        }
+
+        // queue struct and its ring both come out of this arena. caller owns
+        // destruction (call ~SpscQueue before the arena goes away)
+        template<typename T>
+        SpscQueue<T>* make_queue(size_t capacity) {
+            size_t slots = SpscQueue<T>::storage_slots(capacity);
+            void* storage = allocate(slots * sizeof(T), alignof(T) > CACHE_LINE ? alignof(T) : CACHE_LINE);
+            return make<SpscQueue<T>>(capacity, storage);
+        }
+
+        int numa_node() const { return node; }
+        size_t bytes_used() const { return used; }
+        size_t capacity() const { return size; }
+    };
+
+    // per thread counters. written by the owning thread only, read by whoever
+    // wants to know if the core is pegged
+    struct alignas(CACHE_LINE) WorkerStats {
+        std::atomic<uint64_t> busy_ns{0};
+        std::atomic<uint64_t> idle_ns{0};
+        std::atomic<uint64_t> polls{0};
+        std::atomic<uint64_t> busy_polls{0};
+
+        double utilization() const {
+            double busy = busy_ns.load(std::memory_order_relaxed);
+            double idle = idle_ns.load(std::memory_order_relaxed);
+            return busy + idle == 0 ? 0.0 : busy / (busy + idle);
+        }
+    };
+
+    class IdleStrategy {
+        IdleMode mode;
+        uint32_t streak = 0;
+
+        static constexpr uint32_t SPIN_LIMIT = 1000;
+        static constexpr uint32_t YIELD_LIMIT = SPIN_LIMIT + 100;
+        static constexpr int64_t MAX_SLEEP_US = 1000;
+
+    public:
+        explicit IdleStrategy(IdleMode m) : mode(m) {}
+
+        void reset() { streak = 0; }
+
+        void idle() {
+            if (mode == IdleMode::BusySpin) {
+                cpu_relax();
+                return;
+            }
+            ++streak;
+            if (streak < SPIN_LIMIT) {
+                cpu_relax();
+            } else if (streak < YIELD_LIMIT) {
+                std::this_thread::yield();
+            } else {
+                // 1us, 2us, 4us ... capped
+                auto shift = std::min<uint32_t>(streak - YIELD_LIMIT, 10);
+                auto us = std::min<int64_t>(int64_t(1) << shift, MAX_SLEEP_US);
+                std::this_thread::sleep_for(std::chrono::microseconds(us));
+            }
+        }
+    };
+
+    // the busy / idle bookkeeping around a poll loop. the runtime's own
+    // workers use it in run(), and adopt() hands one out so a thread the
+    // runtime didn't start (main as matcher) reports the same numbers
+    class PollMeter {
+        using clock = std::chrono::steady_clock;
+
+        WorkerStats* stats;
+        IdleStrategy idler;
+        clock::time_point last = clock::now();
+
+        // single writer, so plain load + store instead of a locked rmw
+        static void bump(std::atomic<uint64_t>& c, uint64_t by) {
+            c.store(c.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+        }
+
+        uint64_t lap() {
+            auto now = clock::now();
+            auto ns = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count());
+            last = now;
+            return ns;
+        }
+
+    public:
+        PollMeter(WorkerStats& s, IdleMode mode) : stats(&s), idler(mode) {}
+
+        // a poll that did something: time since the last mark was work
+        void busy() {
+            bump(stats->polls, 1);
+            bump(stats->busy_polls, 1);
+            bump(stats->busy_ns, lap());
+            idler.reset();
+        }
+
+        // an empty poll: back off per the idle mode, and count the empty poll
+        // plus the backoff as idle (re-reading the clock after the backoff
+        // keeps the sleep out of the next busy poll)
+        void idle() {
+            bump(stats->polls, 1);
+            idler.idle();
+            bump(stats->idle_ns, lap());
+        }
+
+        // the caller waited on its own (a pacer, a blocking read): time since
+        // the last mark was idle, no poll counted
+        void waited() { bump(stats->idle_ns, lap()); }
+    };
+
+    // what a worker's setup gets handed, running on the already pinned thread
+    struct WorkerContext {
+        Role role;
+        int cpu;
+        // shared so whatever got carved out of it can outlive the runtime,
+        // hold a copy next to anything you allocate here
+        std::shared_ptr<NodeArena> arena;
+        // optional, runs on the worker thread after its last poll (runtime
+        // stopped). lets owners find out their consumer is gone for good
+        std::function<void()> on_exit;
+    };
+
+    // poll returns true if it did any work this round
+    using PollFn = std::function<bool()>;
+    using SetupFn = std::function<PollFn(WorkerContext&)>;
+
+    class Runtime {
+        struct Worker {
+            Role role;
+            ThreadConfig cfg;
+            int node = -1;
+            bool pinned = false;
+            std::shared_ptr<NodeArena> arena;
+            WorkerStats stats;
+            std::thread thread;
+        };
+
+        RuntimeConfig config;
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<bool> running{true};
+        cpu_set_t process_mask;  // affinity of the thread that built us, what cpu -1 gets
+
+        // cpu -1 is supposed to mean "anywhere", but a new thread copies its
+        // creator's mask, so a -1 worker spawned after adopt() would land on
+        // the matcher's core. put it back on the mask we started with instead
+        bool place(int cpu) const {
+            if (cpu >= 0) return pin_current_thread(cpu);
+            if (CPU_COUNT(&process_mask) == 0) return true;
+            return pthread_setaffinity_np(pthread_self(), sizeof(process_mask), &process_mask) == 0;
+        }
+
+        void run(Worker& w, PollFn& poll) {
+            PollMeter meter(w.stats, w.cfg.idle);
+            while (running.load(std::memory_order_relaxed)) {
+                if (poll()) meter.busy();
+                else meter.idle();
+            }
+            // drain whatever's left so nothing gets stuck in a queue on shutdown
+            while (poll()) {}
+        }
+
+    public:
+        // build this before pinning anything, the mask seen here is what
+        // unpinned (cpu -1) threads get
+        explicit Runtime(RuntimeConfig cfg) : config(cfg) {
+            CPU_ZERO(&process_mask);
+            if (pthread_getaffinity_np(pthread_self(), sizeof(process_mask), &process_mask) != 0)
+                CPU_ZERO(&process_mask);
+        }
+        ~Runtime() { stop(); }
+
+        Runtime(const Runtime&) = delete;
+        Runtime& operator=(const Runtime&) = delete;
+
+        const RuntimeConfig& get_config() const { return config; }
+
+        // starts the thread for role, pins it, builds its arena on the local
+        // node and runs setup there. blocks until setup is done so whatever it
+        // allocated (queues etc) is safe to hand to other threads afterwards
+        void spawn(Role role, SetupFn setup) {
+            auto w = std::make_unique<Worker>();
+            w->role = role;
+            w->cfg = config[role];
+            w->node = numa_node_of_cpu(w->cfg.cpu);
+            Worker& ref = *w;
+
+            std::mutex m;
+            std::condition_variable cv;
+            bool ready = false;
+            std::exception_ptr err;
+
+            ref.thread = std::thread([&, setup = std::move(setup)]() mutable {
+                PollFn poll;
+                std::function<void()> on_exit;
+                bool ok = true;
+                try {
+                    ref.pinned = place(ref.cfg.cpu);
+                    ref.arena = std::make_shared<NodeArena>(ref.cfg.arena_bytes, ref.node);
+                    WorkerContext ctx{ ref.role, ref.cfg.cpu, ref.arena, {} };
+                    poll = setup(ctx);
+                    on_exit = std::move(ctx.on_exit);
+                } catch (...) {
+                    err = std::current_exception();
+                    ok = false;
+                }
+                {
+                    // notify under the lock. spawn's locals (m, cv, err) are gone
+                    // as soon as it wakes up, don't touch them past this block
+                    std::lock_guard<std::mutex> lk(m);
+                    ready = true;
+                    cv.notify_one();
+                }
+                if (ok && poll) run(ref, poll);
+                if (ok && on_exit) on_exit();
+            });
+
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait(lk, [&] { return ready; });
+            lk.unlock();
+            if (err) {
+                ref.thread.join();
+                std::rethrow_exception(err);
+            }
+            workers.push_back(std::move(w));
+        }
+
+        // pin the calling thread (e.g. main as matcher) without spawning anything.
+        // threads started after this inherit the pin, so spawn workers (and
+        // start the clock ticker) first. the caller's loop drives the returned
+        // meter, which feeds stats(role) / report() like a spawned worker's
+        PollMeter adopt(Role role) {
+            auto w = std::make_unique<Worker>();
+            w->role = role;
+            w->cfg = config[role];
+            w->node = numa_node_of_cpu(w->cfg.cpu);
+            w->pinned = place(w->cfg.cpu);
+            PollMeter meter(w->stats, w->cfg.idle);
+            workers.push_back(std::move(w));
+            return meter;
+        }
+
+        bool pinned(Role role) const {
+            for (auto& w : workers)
+                if (w->role == role) return w->pinned;
+            return false;
+        }
+
+        void stop() {
+            running.store(false);
+            for (auto& w : workers)
+                if (w->thread.joinable()) w->thread.join();
+        }
+
+        const WorkerStats* stats(Role role) const {
+            for (auto& w : workers)
+                if (w->role == role) return &w->stats;
+            return nullptr;
+        }
+
+        void report(std::ostream& os) const {
+            for (auto& w : workers) {
+                os << std::left << std::setw(10) << role_name(w->role)
+                    << " cpu " << std::setw(3) << w->cfg.cpu
+                    << (w->pinned ? "" : "(unpinned) ")
+                    << " node " << std::setw(2) << w->node
+                    << " " << (w->cfg.idle == IdleMode::BusySpin ? "busy    " : "adaptive")
+                    << " util " << std::fixed << std::setprecision(1)
+                    << w->stats.utilization() * 100.0 << "%"
+                    << " polls " << w->stats.polls.load()
+                    << " arena ";
+                if (w->arena) os << w->arena->bytes_used() << "/" << w->arena->capacity() << "B\n";
+                else os << "-\n";  // adopted thread, no arena
+            }
+        }
+    };
+
+}  // namespace trading::runtime
@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace trading {
+
+    constexpr size_t CACHE_LINE = 64;
+
+    // single producer / single consumer ring. capacity gets rounded up to a
+    // power of two so wrapping is just a mask. slots can come from a NodeArena
+    // (runtime.hpp) so the ring lives on the consumer's numa node.
+    template<typename T>
+    class SpscQueue {
+        static size_t round_up(size_t n) {
+            size_t p = 1;
+            while (p < n) p <<= 1;
+            return p;
+        }
+
+        size_t mask;
+        T* slots;
+        bool owns_slots;
+
+        // producer and consumer indices on separate lines, no false sharing pls
+        alignas(CACHE_LINE) std::atomic<size_t> head{0};  // next to pop
+        size_t cached_tail = 0;                            // consumer's view of tail
+        alignas(CACHE_LINE) std::atomic<size_t> tail{0};  // next to push
+        size_t cached_head = 0;                            // producer's view of head
+
+    public:
+        // storage must hold storage_slots(capacity) Ts, or be null to heap allocate
+        explicit SpscQueue(size_t capacity, void* storage = nullptr)
+            : mask(round_up(capacity < 2 ? 2 : capacity) - 1),
+              slots(nullptr),
+              owns_slots(storage == nullptr) {
+            size_t n = mask + 1;
+            if (owns_slots) {
+                slots = new T[n];
+            } else {
+                slots = static_cast<T*>(storage);
+                for (size_t i = 0; i < n; ++i) new (&slots[i]) T();
+            }
+        }
+
+        ~SpscQueue() {
+            if (owns_slots) {
+                delete[] slots;
+            } else {
+                for (size_t i = 0; i <= mask; ++i) slots[i].~T();
+            }
+        }
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        static size_t storage_slots(size_t capacity) { return round_up(capacity < 2 ? 2 : capacity); }
+
+        size_t capacity() const { return mask + 1; }
+
+        // producer side. never blocks, false if full
+        template<typename U>
+        bool try_push(U&& value) {
+            auto t = tail.load(std::memory_order_relaxed);
+            if (t - cached_head > mask) {
+                cached_head = head.load(std::memory_order_acquire);
+                if (t - cached_head > mask) return false;
+            }
+            slots[t & mask] = std::forward<U>(value);
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer side. false if empty
+        bool try_pop(T& out) {
+            auto h = head.load(std::memory_order_relaxed);
+            if (h == cached_tail) {
+                cached_tail = tail.load(std::memory_order_acquire);
+                if (h == cached_tail) return false;
+            }
+            out = std::move(slots[h & mask]);
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t size_approx() const {
+            return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed);
+        }
+
+        bool empty() const { return size_approx() == 0; }
+    };
+
+}  // namespace trading